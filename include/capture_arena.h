@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+// One heap allocation that holds everything capture needs: the sample ring
+// plus the fixed-size scratch buffers of the send path. Claimed once at
+// startup, after the servers are set up but before WiFi has connected, sized
+// to the largest free block less a reserve, so capture depth grows with
+// whatever RAM the build leaves free.
+//
+// Sub-pools are handed out front to back with take(); the caller takes the
+// fixed-size ones first and gives the ring whatever remains. Calling
+// begin() again frees the old block and claims a fresh one, so stop capture
+// before that.
+
+// Heap left for the network stack after the arena is claimed: the station
+// connection and the fallback access point come up afterwards, and each
+// TCP connection (HTTP, up to WEBSOCKETS_SERVER_CLIENT_MAX WebSockets) needs
+// a few KB for its buffers
+#ifndef CAPTURE_HEAP_RESERVE
+#define CAPTURE_HEAP_RESERVE 16384
+#endif
+
+class CaptureArena {
+public:
+  ~CaptureArena() { end(); }
+
+  bool begin(size_t reserve = CAPTURE_HEAP_RESERVE) {
+    end();
+    size_t largest = ESP.getMaxFreeBlockSize();
+    if (largest <= reserve)
+      return false;
+    // Keep the size a multiple of 4 so every sub-pool stays aligned
+    size_t size = (largest - reserve) & ~(size_t)3;
+    base = (uint8_t *)malloc(size);
+    if (!base)
+      return false;
+    capacity = size;
+    used = 0;
+    return true;
+  }
+
+  void end() {
+    free(base);
+    base = nullptr;
+    capacity = 0;
+    used = 0;
+  }
+
+  // 4-byte aligned sub-pool of `size` bytes, nullptr if it does not fit
+  void *take(size_t size) {
+    size = (size + 3) & ~(size_t)3;
+    if (size > capacity - used)
+      return nullptr;
+    void *p = base + used;
+    used += size;
+    return p;
+  }
+
+  size_t size() const { return capacity; }
+  size_t remaining() const { return capacity - used; }
+
+private:
+  uint8_t *base = nullptr;
+  size_t capacity = 0;
+  size_t used = 0;
+};
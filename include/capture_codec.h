@@ -0,0 +1,310 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "capture_frame.h"
+
+// Compression of frame records for slow links, cheap enough to run on the
+// board at full rate and shared with the host tools. A compressed frame has
+// FRAME_FLAG_COMPRESSED set, an unchanged header (count is still the number
+// of records) and an encoded payload that runs to the end of the frame.
+// Every frame is encoded on its own, so a lost frame costs nothing else.
+//
+// FRAME_SAMPLES payload:
+//   varint  timestamp of the first sample
+//   runs of samples, each
+//     u8      (length - 1) << 2 | xor   xor: line levels that toggle
+//     varint  zigzag(delta change)
+//   The first sample of a run changes the timestamp delta (time since the
+//   previous sample, 0 before the first) by `delta change`; every sample in
+//   the run then toggles `xor` in the levels and advances time by the
+//   delta. A steady clock with unchanged data is one run per 64 samples.
+//
+// FRAME_DECODED payload:
+//   per record  varint  zigzag(delta change) << 4 | flags
+//               (timestamp delta coded as above, first delta from 0 with
+//               the first timestamp sent as a varint up front)
+//   values      LZ77 over the frame's byte values:
+//     u8 c < 0x80   c + 1 literal bytes follow
+//     u8 c >= 0x80  copy (c & 0x7F) + 3 bytes from `distance` back,
+//                   followed by varint distance - 1
+//
+// Varints are LEB128, see framePutVarint() in capture_frame.h.
+
+#define CODEC_MAX_RUN 64
+#define CODEC_MIN_MATCH 3
+#define CODEC_MAX_MATCH (0x7F + CODEC_MIN_MATCH)
+#define CODEC_MAX_LITERALS 0x80
+#define CODEC_HASH_BITS 6
+
+inline uint32_t codecZigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t codecUnzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Streaming FRAME_SAMPLES encoder: add() samples as they are read from the
+// ring, finish() returns the payload size, or 0 if it did not fit in the
+// given space (send the raw frame then).
+class SampleEncoder {
+public:
+  void begin(uint8_t *out, size_t capacity) {
+    start = pos = out;
+    end = out + capacity;
+    runLength = 0;
+    haveSample = false;
+  }
+
+  void add(uint8_t levels, uint32_t timestamp) {
+    if (!haveSample) {
+      pos = framePutVarint(pos, end, timestamp);
+      lastLevels = 0;
+      lastTimestamp = timestamp;
+      lastDelta = 0;
+      haveSample = true;
+    }
+    uint8_t toggled = levels ^ lastLevels;
+    uint32_t delta = timestamp - lastTimestamp;
+    if (levels > 3)
+      pos = nullptr; // only LINE_DATA | LINE_CLOCK fit in a run
+
+    if (runLength > 0 && runLength < CODEC_MAX_RUN &&
+        toggled == runToggled && delta == lastDelta) {
+      runLength++;
+    } else {
+      endRun();
+      runToggled = toggled;
+      runDeltaChange = delta - lastDelta;
+      runLength = 1;
+    }
+    lastLevels = levels;
+    lastTimestamp = timestamp;
+    lastDelta = delta;
+  }
+
+  size_t finish() {
+    endRun();
+    return pos ? pos - start : 0;
+  }
+
+private:
+  void endRun() {
+    if (runLength == 0 || !pos)
+      return;
+    if (pos == end) {
+      pos = nullptr;
+      return;
+    }
+    *pos++ = (uint8_t)((runLength - 1) << 2 | runToggled);
+    pos = framePutVarint(pos, end, codecZigzag((int32_t)runDeltaChange));
+    runLength = 0;
+  }
+
+  uint8_t *start = nullptr;
+  uint8_t *pos = nullptr;
+  uint8_t *end = nullptr;
+  uint32_t lastTimestamp = 0;
+  uint32_t lastDelta = 0;
+  uint32_t runDeltaChange = 0;
+  uint8_t lastLevels = 0;
+  uint8_t runToggled = 0;
+  uint8_t runLength = 0;
+  bool haveSample = false;
+};
+
+// Byte value of FRAME_DECODED record i
+inline uint8_t codecValue(const uint8_t *records, size_t i) {
+  return records[i * FRAME_DECODED_SIZE];
+}
+
+// Appends the values of records [from, to) as literal runs
+inline uint8_t *codecPutLiterals(uint8_t *out, uint8_t *end,
+                                 const uint8_t *records, size_t from,
+                                 size_t to) {
+  while (out && from < to) {
+    size_t chunk = to - from;
+    if (chunk > CODEC_MAX_LITERALS)
+      chunk = CODEC_MAX_LITERALS;
+    if ((size_t)(end - out) < chunk + 1)
+      return nullptr;
+    *out++ = (uint8_t)(chunk - 1);
+    for (size_t k = 0; k < chunk; k++)
+      *out++ = codecValue(records, from++);
+  }
+  return out;
+}
+
+// Encodes `count` FRAME_DECODED records into out; returns the payload size,
+// or 0 if it would not fit in capacity
+inline size_t codecEncodeDecoded(const uint8_t *records, uint16_t count,
+                                 uint8_t *out, size_t capacity) {
+  uint8_t *pos = out;
+  uint8_t *end = out + capacity;
+  if (count == 0)
+    return 0;
+
+  // Timestamps and flags
+  uint32_t lastTimestamp = frameGetU32(records + 2);
+  uint32_t lastDelta = 0;
+  pos = framePutVarint(pos, end, lastTimestamp);
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t *r = records + (size_t)i * FRAME_DECODED_SIZE;
+    uint32_t timestamp = frameGetU32(r + 2);
+    uint32_t delta = timestamp - lastTimestamp;
+    uint32_t change = codecZigzag((int32_t)(delta - lastDelta));
+    if (change >= (1u << 28) || r[1] > 0x0F)
+      return 0;
+    pos = framePutVarint(pos, end, change << 4 | r[1]);
+    lastTimestamp = timestamp;
+    lastDelta = delta;
+  }
+
+  // Byte values: greedy LZ77 with a one-entry-per-bucket hash of the next
+  // three bytes, as in LZF
+  uint16_t table[1 << CODEC_HASH_BITS] = {}; // position + 1
+  size_t n = count;
+  size_t literalStart = 0;
+  size_t i = 0;
+  while (pos && i + CODEC_MIN_MATCH <= n) {
+    uint32_t key = codecValue(records, i) |
+                   codecValue(records, i + 1) << 8 |
+                   codecValue(records, i + 2) << 16;
+    uint32_t hash = (key * 2654435761u) >> (32 - CODEC_HASH_BITS);
+    size_t candidate = table[hash];
+    table[hash] = (uint16_t)(i + 1);
+    size_t from = candidate - 1;
+    size_t length = 0;
+    if (candidate > 0) {
+      while (i + length < n && length < CODEC_MAX_MATCH &&
+             codecValue(records, from + length) ==
+                 codecValue(records, i + length))
+        length++;
+    }
+    if (length < CODEC_MIN_MATCH) {
+      i++;
+      continue;
+    }
+
+    pos = codecPutLiterals(pos, end, records, literalStart, i);
+    if (pos && pos != end) {
+      *pos++ = (uint8_t)(0x80 | (length - CODEC_MIN_MATCH));
+      pos = framePutVarint(pos, end, (uint32_t)(i - from - 1));
+    } else {
+      pos = nullptr;
+    }
+    i += length;
+    literalStart = i;
+  }
+  pos = codecPutLiterals(pos, end, records, literalStart, n);
+  return pos ? pos - out : 0;
+}
+
+inline bool codecDecodeSamples(const uint8_t *in, const uint8_t *end,
+                               uint16_t count, uint8_t *out) {
+  uint32_t timestamp, delta = 0;
+  if (!frameGetVarint(in, end, timestamp))
+    return false;
+  uint8_t levels = 0;
+  uint16_t i = 0;
+  while (i < count) {
+    if (in == end)
+      return false;
+    uint8_t token = *in++;
+    uint32_t change;
+    if (!frameGetVarint(in, end, change))
+      return false;
+    uint8_t length = (token >> 2) + 1;
+    if (length > count - i)
+      return false;
+    delta += (uint32_t)codecUnzigzag(change);
+    for (uint8_t k = 0; k < length; k++, i++) {
+      levels ^= token & 3;
+      timestamp += delta;
+      out += frameWriteSample(out, levels, timestamp);
+    }
+  }
+  return in == end;
+}
+
+inline bool codecDecodeDecoded(const uint8_t *in, const uint8_t *end,
+                               uint16_t count, uint8_t *out) {
+  uint32_t timestamp, delta = 0;
+  if (!frameGetVarint(in, end, timestamp))
+    return false;
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t v;
+    if (!frameGetVarint(in, end, v))
+      return false;
+    delta += (uint32_t)codecUnzigzag(v >> 4);
+    timestamp += delta;
+    frameWriteDecoded(out + (size_t)i * FRAME_DECODED_SIZE, 0,
+                      (uint8_t)(v & 0x0F), timestamp);
+  }
+
+  uint16_t i = 0;
+  while (i < count) {
+    if (in == end)
+      return false;
+    uint8_t c = *in++;
+    if (c < 0x80) {
+      uint16_t length = c + 1;
+      if (length > count - i || length > end - in)
+        return false;
+      for (uint16_t k = 0; k < length; k++, i++)
+        out[(size_t)i * FRAME_DECODED_SIZE] = *in++;
+    } else {
+      uint16_t length = (c & 0x7F) + CODEC_MIN_MATCH;
+      uint32_t distance;
+      if (!frameGetVarint(in, end, distance) || distance >= i ||
+          length > count - i)
+        return false;
+      for (uint16_t k = 0; k < length; k++, i++)
+        out[(size_t)i * FRAME_DECODED_SIZE] =
+            out[(size_t)(i - distance - 1) * FRAME_DECODED_SIZE];
+    }
+  }
+  return in == end;
+}
+
+// Copies a frame to out with its records decoded, FRAME_FLAG_COMPRESSED
+// cleared. Uncompressed frames, summaries included, are copied as they
+// are. Returns the raw frame's length, 0 if the frame is malformed or out
+// is too small.
+inline size_t frameExpand(const uint8_t *in, size_t len, uint8_t *out,
+                          size_t capacity) {
+  FrameHeader header;
+  if (!frameReadHeader(in, len, header))
+    return 0;
+  if (header.type == FRAME_SUMMARY) {
+    if (len > capacity)
+      return 0;
+    memcpy(out, in, len);
+    return len;
+  }
+  size_t rawLength =
+      FRAME_HEADER_SIZE + (size_t)header.count * frameRecordSize(header.type);
+  if (rawLength > capacity)
+    return 0;
+  if (!(header.flags & FRAME_FLAG_COMPRESSED)) {
+    memcpy(out, in, rawLength);
+    return rawLength;
+  }
+
+  header.flags &= ~FRAME_FLAG_COMPRESSED;
+  frameWriteHeader(out, header);
+  const uint8_t *payload = in + FRAME_HEADER_SIZE;
+  bool ok = false;
+  if (header.count == 0)
+    ok = payload == in + len;
+  else if (header.type == FRAME_SAMPLES)
+    ok = codecDecodeSamples(payload, in + len, header.count,
+                            out + FRAME_HEADER_SIZE);
+  else if (header.type == FRAME_DECODED)
+    ok = codecDecodeDecoded(payload, in + len, header.count,
+                            out + FRAME_HEADER_SIZE);
+  return ok ? rawLength : 0;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary capture frame - the unit every transport carries (WebSocket binary
+// message, serial link packet) and the host tools read back. Plain C++ with
+// no Arduino dependency so the firmware and the native host build share it.
+//
+// All multi-byte fields are little-endian.
+//
+//   offset  size  field
+//   0       1     magic             FRAME_MAGIC
+//   1       1     version           FRAME_VERSION
+//   2       1     type              FrameType
+//   3       1     flags             FRAME_FLAG_*
+//   4       4     seq               frame counter, a gap means frames were lost
+//   8       4     sampleCount       samples captured since the capture
+//                                   ring was set up
+//   12      4     baudRate          estimated clock edges per second
+//   16      4     bufferSize        capture ring capacity in samples
+//   20      4     samplesAvailable  ring fill level when the frame was built
+//   24      2     count             number of records that follow
+//   26      ...   records
+//
+// FRAME_SAMPLES record (FRAME_SAMPLE_SIZE bytes):
+//   0       1     data              line levels, LINE_DATA | LINE_CLOCK
+//                                   (protocol_decoders.h)
+//   1       4     timestamp         micros() at the edge
+//
+// FRAME_DECODED record (FRAME_DECODED_SIZE bytes):
+//   0       1     value             decoded byte
+//   1       1     flags             DECODED_* (protocol_decoders.h)
+//   2       4     timestamp         micros() at the byte's first bit
+//
+// FRAME_SUMMARY: count is the number of u32 words of traffic statistics,
+// laid out as StatsWord (traffic_stats.h). Most of them are empty histogram
+// buckets, so only the non-zero words are sent, each as two varints:
+//   varint  zero words skipped since the previous one sent
+//   varint  word
+// up to the end of the frame. statsReadSummary() reads them back.
+
+#define FRAME_MAGIC 0x44 // 'D'
+#define FRAME_VERSION 1
+#define FRAME_HEADER_SIZE 26
+#define FRAME_SAMPLE_SIZE 5
+#define FRAME_DECODED_SIZE 6
+#define FRAME_SUMMARY_SIZE 4 // per word, once read back
+
+// Largest frame the header can describe (count is 16 bits)
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE + 0xFFFF * FRAME_DECODED_SIZE)
+
+// Unsent samples were lost before this frame, or (FRAME_DECODED) decoded
+// bytes did not fit in it
+#define FRAME_FLAG_OVERFLOW 0x01
+#define FRAME_FLAG_COMPRESSED 0x02 // records encoded, see capture_codec.h
+
+enum FrameType {
+  FRAME_SAMPLES = 1, // raw line samples
+  FRAME_DECODED = 2, // bytes from the on-device protocol decoder
+  FRAME_SUMMARY = 3, // traffic statistics over all decoded bytes
+};
+
+struct FrameHeader {
+  uint8_t type;
+  uint8_t flags;
+  uint32_t seq;
+  uint32_t sampleCount;
+  uint32_t baudRate;
+  uint32_t bufferSize;
+  uint32_t samplesAvailable;
+  uint16_t count;
+};
+
+struct FrameSample {
+  uint8_t data;
+  uint32_t timestamp;
+};
+
+struct FrameDecoded {
+  uint8_t value;
+  uint8_t flags;
+  uint32_t timestamp;
+};
+
+// Record size for a frame type, 0 if unknown
+inline size_t frameRecordSize(uint8_t type) {
+  switch (type) {
+  case FRAME_SAMPLES:
+    return FRAME_SAMPLE_SIZE;
+  case FRAME_DECODED:
+    return FRAME_DECODED_SIZE;
+  case FRAME_SUMMARY:
+    return FRAME_SUMMARY_SIZE;
+  default:
+    return 0;
+  }
+}
+
+inline void framePutU16(uint8_t *out, uint16_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+}
+
+inline void framePutU32(uint8_t *out, uint32_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+inline uint16_t frameGetU16(const uint8_t *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+inline uint32_t frameGetU32(const uint8_t *in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+         ((uint32_t)in[3] << 24);
+}
+
+// Appends a LEB128 varint (7 bits per byte, low first) if it fits before
+// end; returns the new position, or nullptr once out of room (also when out
+// is already nullptr, so calls chain)
+inline uint8_t *framePutVarint(uint8_t *out, uint8_t *end, uint32_t v) {
+  while (out) {
+    if (out == end)
+      return nullptr;
+    if (v < 0x80) {
+      *out++ = (uint8_t)v;
+      return out;
+    }
+    *out++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  return nullptr;
+}
+
+// Reads a varint; returns false if it runs past end or over 32 bits
+inline bool frameGetVarint(const uint8_t *&in, const uint8_t *end,
+                           uint32_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (in == end)
+      return false;
+    uint8_t b = *in++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Writes the header, returns the number of bytes written
+inline size_t frameWriteHeader(uint8_t *out, const FrameHeader &h) {
+  out[0] = FRAME_MAGIC;
+  out[1] = FRAME_VERSION;
+  out[2] = h.type;
+  out[3] = h.flags;
+  framePutU32(out + 4, h.seq);
+  framePutU32(out + 8, h.sampleCount);
+  framePutU32(out + 12, h.baudRate);
+  framePutU32(out + 16, h.bufferSize);
+  framePutU32(out + 20, h.samplesAvailable);
+  framePutU16(out + 24, h.count);
+  return FRAME_HEADER_SIZE;
+}
+
+inline size_t frameWriteSample(uint8_t *out, uint8_t data,
+                               uint32_t timestamp) {
+  out[0] = data;
+  framePutU32(out + 1, timestamp);
+  return FRAME_SAMPLE_SIZE;
+}
+
+inline size_t frameWriteDecoded(uint8_t *out, uint8_t value, uint8_t flags,
+                                uint32_t timestamp) {
+  out[0] = value;
+  out[1] = flags;
+  framePutU32(out + 2, timestamp);
+  return FRAME_DECODED_SIZE;
+}
+
+// Returns false if the buffer does not hold a well-formed frame of this
+// version (bad magic, unknown version or type, truncated records). The
+// variable-length payloads of summary and compressed frames are only
+// checked when they are read.
+inline bool frameReadHeader(const uint8_t *in, size_t len, FrameHeader &h) {
+  if (len < FRAME_HEADER_SIZE || in[0] != FRAME_MAGIC ||
+      in[1] != FRAME_VERSION)
+    return false;
+  h.type = in[2];
+  h.flags = in[3];
+  h.seq = frameGetU32(in + 4);
+  h.sampleCount = frameGetU32(in + 8);
+  h.baudRate = frameGetU32(in + 12);
+  h.bufferSize = frameGetU32(in + 16);
+  h.samplesAvailable = frameGetU32(in + 20);
+  h.count = frameGetU16(in + 24);
+  size_t recordSize = frameRecordSize(h.type);
+  if (recordSize == 0)
+    return false;
+  if (h.type != FRAME_SUMMARY && !(h.flags & FRAME_FLAG_COMPRESSED) &&
+      len < FRAME_HEADER_SIZE + (size_t)h.count * recordSize)
+    return false;
+  return true;
+}
+
+// Record i of a FRAME_SAMPLES frame already validated by frameReadHeader()
+inline FrameSample frameReadSample(const uint8_t *in, uint16_t i) {
+  const uint8_t *p = in + FRAME_HEADER_SIZE + (size_t)i * FRAME_SAMPLE_SIZE;
+  FrameSample s;
+  s.data = p[0];
+  s.timestamp = frameGetU32(p + 1);
+  return s;
+}
+
+// Record i of a FRAME_DECODED frame already validated by frameReadHeader()
+inline FrameDecoded frameReadDecoded(const uint8_t *in, uint16_t i) {
+  const uint8_t *p = in + FRAME_HEADER_SIZE + (size_t)i * FRAME_DECODED_SIZE;
+  FrameDecoded d;
+  d.value = p[0];
+  d.flags = p[1];
+  d.timestamp = frameGetU32(p + 2);
+  return d;
+}
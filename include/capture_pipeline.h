@@ -0,0 +1,203 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <type_traits>
+
+#include "capture_arena.h"
+#include "protocol_decoders.h"
+
+// Compile-time configured capture pipeline: edge interrupt -> sample ring ->
+// protocol decoder. Everything that shapes the hot path is a constexpr
+// member or typedef of the Config struct, so each build variant's ISR
+// compiles down to just the work that variant needs:
+//
+//   struct MyConfig : DefaultCaptureConfig {
+//     static constexpr uint8_t kChannelMask = LINE_DATA;   // lines stored
+//     typedef NoClock Clock;                               // timestamp source
+//     typedef I2cDecoder Decoder;                          // protocol
+//     static Decoder makeDecoder() { return Decoder(); }
+//   };
+//   typedef CapturePipeline<MyConfig> Pipeline;
+//
+// The ring itself is sized at run time: begin() gives it everything left in
+// the CaptureArena, at 5 bytes per sample with timestamps or 1 without.
+//
+// The ISR only ever writes at the head; readers keep their own Cursor and
+// detect being lapped themselves, so the ISR needs no tail bookkeeping.
+
+// Timestamp sources
+struct MicrosClock {
+  static constexpr bool kEnabled = true;
+  static inline uint32_t IRAM_ATTR now() { return micros(); }
+};
+
+// No timestamps: samples are just line levels and the ISR skips the clock
+// read entirely. Only for decoders that don't need timing.
+struct NoClock {
+  static constexpr bool kEnabled = false;
+  static inline uint32_t now() { return 0; }
+};
+
+struct DefaultCaptureConfig {
+  // NodeMCU v2: D5 = GPIO14 (SCK / SCL), D6 = GPIO12 (MISO / SDA / RX)
+  static constexpr uint8_t kClockPin = 14;
+  static constexpr uint8_t kDataPin = 12;
+  static constexpr uint8_t kChannelMask = LINE_DATA | LINE_CLOCK;
+  // begin() fails rather than run with a smaller ring
+  static constexpr uint32_t kMinRingCapacity = 256;
+  typedef MicrosClock Clock;
+  typedef SpiDecoder<0> Decoder;
+  static Decoder makeDecoder() { return Decoder(); }
+};
+
+// A reader's position in the ring. `position` counts samples since the
+// ring was set up, like the ring head, and `slot` is where that sample
+// lives; `lost` counts samples overwritten before this reader got to them.
+struct CaptureCursor {
+  uint32_t position = 0;
+  uint32_t slot = 0;
+  uint32_t lost = 0;
+};
+
+template <class Config> class CapturePipeline {
+public:
+  typedef typename Config::Clock Clock;
+  typedef typename Config::Decoder Decoder;
+
+  static constexpr uint8_t kChannelMask = Config::kChannelMask;
+  static constexpr size_t kSampleBytes = Clock::kEnabled ? 5 : 1;
+
+  static_assert((Decoder::kInterruptLines & ~kChannelMask) == 0,
+                "decoder needs a line the channel mask does not store");
+  static_assert(Clock::kEnabled || !Decoder::kNeedsTimestamps,
+                "decoder needs timestamps");
+  static_assert(std::is_same<decltype(Config::makeDecoder()), Decoder>::value,
+                "a config that changes Decoder must also define makeDecoder()");
+
+  // Takes the rest of the arena for the ring and starts capturing. Stops
+  // capture first if it was running, so it also serves to reconfigure;
+  // every reader's cursor must be reset to CaptureCursor() afterwards. If
+  // the arena itself is claimed again, call end() before that: the ISR
+  // writes into the old block until it is detached.
+  static bool begin(CaptureArena &arena) {
+    end();
+    uint32_t samples = arena.remaining() / kSampleBytes;
+    if (samples < Config::kMinRingCapacity)
+      return false;
+    if constexpr (Clock::kEnabled)
+      timestamps = (uint32_t *)arena.take(samples * 4);
+    levels = (uint8_t *)arena.take(samples);
+    ringCapacity = samples;
+    head = 0;
+    headSlot = 0;
+    decoder.reset();
+
+    pinMode(Config::kClockPin, INPUT_PULLUP);
+    pinMode(Config::kDataPin, INPUT_PULLUP);
+    // Both edges, so every level change on a watched line is sampled
+    if (Decoder::kInterruptLines & LINE_CLOCK)
+      attachInterrupt(digitalPinToInterrupt(Config::kClockPin), onEdge,
+                      CHANGE);
+    if (Decoder::kInterruptLines & LINE_DATA)
+      attachInterrupt(digitalPinToInterrupt(Config::kDataPin), onEdge,
+                      CHANGE);
+    return true;
+  }
+
+  static void end() {
+    if (Decoder::kInterruptLines & LINE_CLOCK)
+      detachInterrupt(digitalPinToInterrupt(Config::kClockPin));
+    if (Decoder::kInterruptLines & LINE_DATA)
+      detachInterrupt(digitalPinToInterrupt(Config::kDataPin));
+    ringCapacity = 0;
+  }
+
+  static void IRAM_ATTR onEdge() {
+    // The capacity is not a power of two, so the slot wraps by compare
+    // rather than by mask (the ESP8266 has no divide instruction)
+    uint32_t slot = headSlot;
+    if constexpr (Clock::kEnabled)
+      timestamps[slot] = Clock::now();
+
+    // Read both lines in one register access so the decoder sees a
+    // consistent pair of levels
+    uint32_t gpio = GPI;
+    uint8_t sample = 0;
+    if constexpr (kChannelMask & LINE_DATA)
+      sample |= (gpio >> Config::kDataPin) & 1;
+    if constexpr (kChannelMask & LINE_CLOCK)
+      sample |= ((gpio >> Config::kClockPin) & 1) << 1;
+    levels[slot] = sample;
+
+    // Publish the slot only after it is written
+    __asm__ __volatile__("" ::: "memory");
+    headSlot = slot + 1 == ringCapacity ? 0 : slot + 1;
+    head = head + 1;
+  }
+
+  // Ring capacity in samples, 0 while not capturing
+  static uint32_t capacity() { return ringCapacity; }
+
+  // Samples captured since the ring was set up
+  static uint32_t sampleCount() { return head; }
+
+  // Samples the cursor has not read yet (at most the ring capacity)
+  static uint32_t available(const CaptureCursor &cursor) {
+    uint32_t pending = head - cursor.position;
+    return pending > ringCapacity ? ringCapacity : pending;
+  }
+
+  // Passes up to max unread samples to fn(levels, timestamp) and advances
+  // the cursor. If the ISR lapped the cursor the oldest samples are skipped
+  // and counted in cursor.lost. Returns the number of samples delivered.
+  template <class Fn>
+  static uint32_t read(CaptureCursor &cursor, uint32_t max, Fn fn) {
+    uint32_t delivered = 0;
+    while (delivered < max) {
+      uint32_t h = head;
+      if (h - cursor.position > ringCapacity) {
+        // Positions wrap at 2^32, which is not a multiple of the capacity,
+        // so the slot comes from the ISR's own (head, headSlot) pair, read
+        // again if an edge came in between. A full lap behind the head is
+        // the head's slot.
+        uint32_t slot;
+        do {
+          h = head;
+          slot = headSlot;
+        } while (h != head);
+        cursor.lost += h - cursor.position - ringCapacity;
+        cursor.position = h - ringCapacity;
+        cursor.slot = slot;
+      }
+      if (cursor.position == h)
+        break;
+
+      uint32_t slot = cursor.slot;
+      uint8_t sample = levels[slot];
+      uint32_t timestamp = 0;
+      if constexpr (Clock::kEnabled)
+        timestamp = timestamps[slot];
+
+      // The ISR may have reused the slot while we copied it
+      __asm__ __volatile__("" ::: "memory");
+      if (head - cursor.position > ringCapacity)
+        continue;
+
+      fn(sample, timestamp);
+      cursor.position++;
+      cursor.slot = slot + 1 == ringCapacity ? 0 : slot + 1;
+      delivered++;
+    }
+    return delivered;
+  }
+
+  static inline Decoder decoder = Config::makeDecoder();
+
+private:
+  static inline volatile uint32_t head = 0;
+  static inline volatile uint32_t headSlot = 0;
+  static inline uint32_t ringCapacity = 0;
+  static inline uint8_t *levels = nullptr;
+  static inline uint32_t *timestamps = nullptr;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+// Memory-mapped, append-only capture store for the Linux host tools.
+//
+// A store is a directory per capture source holding four logs:
+//
+//   frames.log  [u64 timeUs][u32 length][frame bytes][pad to 8]  raw frames
+//   frames.idx  [u64 timeUs][u64 offset]     one entry per frame, by time
+//   bytes.log   decoded bytes, back to back  (searched with memmem)
+//   bytes.idx   [u64 timeUs][u64 offset]     one entry per transaction
+//
+// timeUs is host wall-clock time in microseconds. Every log starts with a
+// STORE_HEADER_SIZE header whose `used` field is published only after the
+// data it covers has been written, so readers (the decoder thread, a
+// concurrent query) never see a partial record. Each log reserves a large
+// fixed virtual mapping up front and only grows the file underneath it, so
+// pointers into a log stay valid while it grows.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#define STORE_MAGIC "DRMLOG1"
+#define STORE_HEADER_SIZE 64
+#define STORE_RESERVE (1ull << 38) // virtual address space per log
+#define STORE_GROW_STEP (64ull << 20)
+
+struct IndexEntry {
+  uint64_t timeUs;
+  uint64_t offset;
+};
+
+class MappedLog {
+public:
+  ~MappedLog() { close(); }
+
+  bool open(const std::string &path, bool writable) {
+    this->writable = writable;
+    fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0) {
+      perror(path.c_str());
+      return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    fileSize = (uint64_t)st.st_size;
+    if (fileSize < STORE_HEADER_SIZE) {
+      if (!writable || ftruncate(fd, STORE_GROW_STEP) != 0) {
+        fprintf(stderr, "%s: not a capture log\n", path.c_str());
+        return false;
+      }
+      fileSize = STORE_GROW_STEP;
+    }
+
+    void *p = mmap(nullptr, STORE_RESERVE,
+                   writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED | MAP_NORESERVE, fd, 0);
+    if (p == MAP_FAILED) {
+      perror("mmap");
+      return false;
+    }
+    base = (uint8_t *)p;
+
+    if (memcmp(base, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0) {
+      if (!writable || size() != 0) {
+        fprintf(stderr, "%s: not a capture log\n", path.c_str());
+        return false;
+      }
+      memcpy(base, STORE_MAGIC, sizeof(STORE_MAGIC));
+    }
+    return true;
+  }
+
+  void close() {
+    if (base) {
+      if (writable) {
+        // Give back the unused tail of the last growth step
+        uint64_t end = STORE_HEADER_SIZE + size();
+        ftruncate(fd, (off_t)end);
+      }
+      munmap(base, STORE_RESERVE);
+      base = nullptr;
+    }
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  // Bytes of committed data (excluding the header)
+  uint64_t size() const { return __atomic_load_n(usedField(), __ATOMIC_ACQUIRE); }
+
+  const uint8_t *data() const { return base + STORE_HEADER_SIZE; }
+
+  // Free-form progress counter for whoever consumes this log
+  uint64_t cursor() const { return __atomic_load_n(cursorField(), __ATOMIC_ACQUIRE); }
+  void setCursor(uint64_t v) { __atomic_store_n(cursorField(), v, __ATOMIC_RELEASE); }
+
+  // Space for len more bytes; the caller fills it and then calls commit()
+  uint8_t *reserve(uint64_t len) {
+    uint64_t end = STORE_HEADER_SIZE + size() + len;
+    if (end > STORE_RESERVE)
+      return nullptr;
+    if (end > fileSize) {
+      uint64_t newSize = (end + STORE_GROW_STEP - 1) / STORE_GROW_STEP * STORE_GROW_STEP;
+      if (ftruncate(fd, (off_t)newSize) != 0) {
+        perror("ftruncate");
+        return nullptr;
+      }
+      fileSize = newSize;
+    }
+    return base + STORE_HEADER_SIZE + size();
+  }
+
+  void commit(uint64_t len) {
+    __atomic_store_n(usedField(), size() + len, __ATOMIC_RELEASE);
+  }
+
+  bool append(const void *src, uint64_t len) {
+    uint8_t *dst = reserve(len);
+    if (!dst)
+      return false;
+    memcpy(dst, src, len);
+    commit(len);
+    return true;
+  }
+
+private:
+  uint64_t *usedField() const { return (uint64_t *)(base + 8); }
+  uint64_t *cursorField() const { return (uint64_t *)(base + 16); }
+
+  int fd = -1;
+  bool writable = false;
+  uint8_t *base = nullptr;
+  uint64_t fileSize = 0;
+};
+
+class CaptureStore {
+public:
+  bool open(const std::string &dir, bool writable) {
+    if (writable)
+      mkdir(dir.c_str(), 0755);
+    return frames.open(dir + "/frames.log", writable) &&
+           frameIndex.open(dir + "/frames.idx", writable) &&
+           bytes.open(dir + "/bytes.log", writable) &&
+           byteIndex.open(dir + "/bytes.idx", writable);
+  }
+
+  bool appendFrame(uint64_t timeUs, const uint8_t *frame, uint32_t len) {
+    uint64_t recordLength = (12 + len + 7) & ~7ull;
+    uint8_t *dst = frames.reserve(recordLength);
+    if (!dst)
+      return false;
+    memcpy(dst, &timeUs, 8);
+    memcpy(dst + 8, &len, 4);
+    memcpy(dst + 12, frame, len);
+    IndexEntry entry = {timeUs, frames.size()};
+    frames.commit(recordLength);
+    return frameIndex.append(&entry, sizeof(entry));
+  }
+
+  uint64_t frameCount() const { return frameIndex.size() / sizeof(IndexEntry); }
+
+  const IndexEntry &frameEntry(uint64_t i) const {
+    return ((const IndexEntry *)frameIndex.data())[i];
+  }
+
+  const uint8_t *frameData(uint64_t i, uint32_t &len) const {
+    const uint8_t *record = frames.data() + frameEntry(i).offset;
+    memcpy(&len, record + 8, 4);
+    return record + 12;
+  }
+
+  // Starts a new decoded transaction at timeUs
+  bool beginTransaction(uint64_t timeUs) {
+    IndexEntry entry = {timeUs, bytes.size()};
+    return byteIndex.append(&entry, sizeof(entry));
+  }
+
+  bool appendBytes(const uint8_t *data, size_t len) {
+    return bytes.append(data, len);
+  }
+
+  uint64_t transactionCount() const {
+    return byteIndex.size() / sizeof(IndexEntry);
+  }
+
+  const IndexEntry &transactionEntry(uint64_t i) const {
+    return ((const IndexEntry *)byteIndex.data())[i];
+  }
+
+  // Byte range [begin, end) of transaction i
+  void transactionRange(uint64_t i, uint64_t &begin, uint64_t &end) const {
+    begin = transactionEntry(i).offset;
+    end = i + 1 < transactionCount() ? transactionEntry(i + 1).offset
+                                     : bytes.size();
+  }
+
+  const uint8_t *byteData() const { return bytes.data(); }
+
+  // Frames fully decoded into bytes.log, kept in its header so a restarted
+  // daemon resumes decoding where it stopped
+  uint64_t decodedFrames() const { return bytes.cursor(); }
+  void setDecodedFrames(uint64_t n) { bytes.setCursor(n); }
+
+  MappedLog frames, frameIndex, bytes, byteIndex;
+};
+
+// First index entry with timeUs >= t
+inline uint64_t lowerBoundByTime(const IndexEntry *entries, uint64_t count,
+                                 uint64_t t) {
+  uint64_t lo = 0, hi = count;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (entries[mid].timeUs < t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
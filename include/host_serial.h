@@ -0,0 +1,82 @@
+#pragma once
+
+// Serial port helpers shared by the Linux host tools (not used on-device)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+// LinkWriter sink for a file descriptor
+struct FdSink {
+  int fd;
+
+  void write(const uint8_t *data, size_t len) {
+    while (len > 0) {
+      ssize_t n = ::write(fd, data, len);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        perror("write");
+        exit(1);
+      }
+      data += n;
+      len -= (size_t)n;
+    }
+  }
+};
+
+inline speed_t baudToSpeed(long baud) {
+  switch (baud) {
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  case 1500000:
+    return B1500000;
+  case 2000000:
+    return B2000000;
+  case 3000000:
+    return B3000000;
+  default:
+    return 0;
+  }
+}
+
+// Opens the port raw at the requested speed. On a pty the speed is ignored.
+inline int openSerialPort(const char *path, long baud) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    speed_t speed = baudToSpeed(baud);
+    if (speed == 0) {
+      fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+      close(fd);
+      return -1;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIFLUSH);
+  }
+  return fd;
+}
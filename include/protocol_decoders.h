@@ -0,0 +1,289 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Protocol decoders for the two-wire capture input. Shared by the firmware
+// and the native host tools, so no Arduino dependency.
+//
+// Every decoder is a plain class with the same shape - no base class, no
+// virtual functions - and is used through templates so the per-sample call
+// inlines into the capture loop:
+//
+//   template <class Sink> void feed(uint8_t levels, uint32_t timestamp, Sink &sink);
+//   template <class Sink> void flush(uint32_t now, Sink &sink);
+//   void reset();
+//   static constexpr uint8_t kInterruptLines;  // lines whose edges must be sampled
+//   static constexpr bool kNeedsTimestamps;    // can't decode without them
+//   static const char *name();
+//
+// `levels` is a sample's line state (LINE_DATA | LINE_CLOCK bits) and
+// `timestamp` its micros(). Decoded bytes go to
+//
+//   sink.onByte(uint8_t value, uint32_t timestamp, uint8_t flags);
+//
+// where timestamp is that of the byte's first bit and flags is a mask of
+// DECODED_* below. flush() is called periodically with the current time so
+// a decoder that can only finish a byte on a later edge (UART) does not
+// hold it back indefinitely; the others ignore it.
+
+#define LINE_DATA 0x01  // MISO / SDA / RX
+#define LINE_CLOCK 0x02 // SCK / SCL (unused by UART)
+
+#define DECODED_START 0x01   // first byte of a transaction
+#define DECODED_ADDRESS 0x02 // I2C address byte (R/W in bit 0)
+#define DECODED_NAK 0x04     // I2C byte was not acknowledged
+#define DECODED_ERROR 0x08   // framing error (UART stop bit low)
+
+// A clock pause longer than this ends an SPI transaction
+#define DECODER_DEFAULT_GAP_US 100
+
+// SPI, any of the four modes. Mode bit 1 is CPOL, bit 0 is CPHA; data is
+// sampled on the rising clock edge when CPOL == CPHA, on the falling edge
+// otherwise. There is no chip-select line, so transactions are delimited by
+// clock pauses longer than gapUs.
+template <uint8_t Mode, bool MsbFirst = true> class SpiDecoder {
+public:
+  static constexpr uint8_t kInterruptLines = LINE_CLOCK;
+  // Without timestamps bytes still decode, but clock pauses no longer
+  // split transactions
+  static constexpr bool kNeedsTimestamps = false;
+  static constexpr bool kSampleOnRising = ((Mode >> 1) & 1) == (Mode & 1);
+
+  explicit SpiDecoder(uint32_t gapUs = DECODER_DEFAULT_GAP_US)
+      : gapUs(gapUs) {}
+
+  static const char *name() {
+    static const char *names[] = {"spi0", "spi1", "spi2", "spi3"};
+    return names[Mode & 3];
+  }
+
+  void reset() {
+    bits = 0;
+    value = 0;
+    inTransaction = false;
+    haveEdge = false;
+  }
+
+  template <class Sink>
+  void feed(uint8_t levels, uint32_t timestamp, Sink &sink) {
+    bool clock = levels & LINE_CLOCK;
+    if (haveEdge && clock == lastClock)
+      return; // data-line change or a repeated level, not a clock edge
+    lastClock = clock;
+    if (clock != kSampleOnRising)
+      return;
+
+    if (!haveEdge || timestamp - lastEdgeTime > gapUs) {
+      inTransaction = false;
+      bits = 0;
+      value = 0;
+    }
+    haveEdge = true;
+    lastEdgeTime = timestamp;
+
+    if (bits == 0)
+      byteTime = timestamp;
+    uint8_t bit = levels & LINE_DATA;
+    if (MsbFirst)
+      value = (uint8_t)((value << 1) | bit);
+    else
+      value = (uint8_t)(value | (bit << bits));
+    if (++bits < 8)
+      return;
+
+    sink.onByte(value, byteTime, inTransaction ? 0 : DECODED_START);
+    inTransaction = true;
+    bits = 0;
+    value = 0;
+  }
+
+  template <class Sink> void flush(uint32_t, Sink &) {}
+
+private:
+  uint32_t gapUs;
+  uint32_t lastEdgeTime = 0;
+  uint32_t byteTime = 0;
+  uint8_t value = 0;
+  uint8_t bits = 0;
+  bool lastClock = false;
+  bool haveEdge = false;
+  bool inTransaction = false;
+};
+
+// I2C: START/STOP from SDA changes while SCL is high, bits sampled on the
+// SCL rising edge, the ninth bit is the ACK. Needs edges on both lines.
+class I2cDecoder {
+public:
+  static constexpr uint8_t kInterruptLines = LINE_CLOCK | LINE_DATA;
+  static constexpr bool kNeedsTimestamps = false;
+
+  static const char *name() { return "i2c"; }
+
+  void reset() {
+    inFrame = false;
+    bits = 0;
+    value = 0;
+    haveLevels = false;
+  }
+
+  template <class Sink>
+  void feed(uint8_t levels, uint32_t timestamp, Sink &sink) {
+    if (!haveLevels) {
+      lastLevels = levels;
+      haveLevels = true;
+      return;
+    }
+    uint8_t changed = levels ^ lastLevels;
+    bool clockHigh = levels & LINE_CLOCK;
+    bool wasClockHigh = lastLevels & LINE_CLOCK;
+    lastLevels = levels;
+
+    if ((changed & LINE_DATA) && clockHigh && wasClockHigh) {
+      if (!(levels & LINE_DATA)) {
+        // START or repeated START: next byte is an address
+        inFrame = true;
+        first = true;
+        bits = 0;
+        value = 0;
+      } else {
+        inFrame = false; // STOP
+      }
+      return;
+    }
+
+    if (!inFrame || !(changed & LINE_CLOCK) || !clockHigh)
+      return;
+
+    // SCL rising edge
+    if (bits < 8) {
+      if (bits == 0)
+        byteTime = timestamp;
+      value = (uint8_t)((value << 1) | (levels & LINE_DATA));
+      bits++;
+      return;
+    }
+
+    uint8_t flags = 0;
+    if (first)
+      flags |= DECODED_START | DECODED_ADDRESS;
+    if (levels & LINE_DATA)
+      flags |= DECODED_NAK;
+    sink.onByte(value, byteTime, flags);
+    first = false;
+    bits = 0;
+    value = 0;
+  }
+
+  template <class Sink> void flush(uint32_t, Sink &) {}
+
+private:
+  uint32_t byteTime = 0;
+  uint8_t lastLevels = 0;
+  uint8_t value = 0;
+  uint8_t bits = 0;
+  bool haveLevels = false;
+  bool inFrame = false;
+  bool first = false;
+};
+
+// UART 8N1, LSB first, on the data line. The bit period is fixed at
+// construction; only data-line edges are needed. A byte whose trailing bits
+// are all 1 has no edge after it, so it is emitted on the next start bit or
+// when flush() is called with a later time. Bytes separated by more than
+// gapBits bit periods of idle line start a new transaction.
+template <bool Inverted = false> class UartDecoder {
+public:
+  static constexpr uint8_t kInterruptLines = LINE_DATA;
+  static constexpr bool kNeedsTimestamps = true;
+
+  explicit UartDecoder(uint32_t baud = 115200, uint32_t gapBits = 20)
+      : bitTime256((uint32_t)((256ull * 1000000 + baud / 2) / baud)),
+        gapUs((uint32_t)((uint64_t)gapBits * 1000000 / baud)) {}
+
+  static const char *name() { return Inverted ? "uart-inv" : "uart"; }
+
+  void reset() {
+    inFrame = false;
+    haveLevel = false;
+    haveByte = false;
+  }
+
+  template <class Sink>
+  void feed(uint8_t levels, uint32_t timestamp, Sink &sink) {
+    bool level = ((levels & LINE_DATA) != 0) != Inverted;
+    if (!haveLevel) {
+      lastLevel = level;
+      haveLevel = true;
+      return;
+    }
+    if (level == lastLevel)
+      return;
+
+    if (inFrame) {
+      // The line held lastLevel from the previous edge until now
+      fillBits(timestamp);
+      if (nextBit >= 10)
+        finishByte(sink);
+    }
+    lastLevel = level;
+
+    if (!inFrame && !level) {
+      // Falling edge on an idle line: start bit
+      inFrame = true;
+      frameStart = timestamp;
+      nextBit = 0;
+      shift = 0;
+    }
+  }
+
+  // Completes a byte whose final bits produced no edge, once `now` is past
+  // its stop bit
+  template <class Sink> void flush(uint32_t now, Sink &sink) {
+    if (!inFrame)
+      return;
+    fillBits(now);
+    if (nextBit >= 10)
+      finishByte(sink);
+  }
+
+private:
+  // Assigns lastLevel to every bit whose centre lies before `until`
+  void fillBits(uint32_t until) {
+    uint32_t elapsed = until - frameStart;
+    if (elapsed > 0xFFFFFF)
+      elapsed = 0xFFFFFF; // keep elapsed * 256 in range
+    while (nextBit < 10 &&
+           (uint32_t)(nextBit * 2 + 1) * bitTime256 / 2 < elapsed * 256) {
+      if (nextBit >= 1 && nextBit <= 8 && lastLevel)
+        shift |= (uint8_t)(1 << (nextBit - 1));
+      if (nextBit == 9)
+        stopBit = lastLevel;
+      nextBit++;
+    }
+  }
+
+  template <class Sink> void finishByte(Sink &sink) {
+    uint8_t flags = 0;
+    if (!haveByte || frameStart - lastByteEnd > gapUs)
+      flags |= DECODED_START;
+    if (!stopBit)
+      flags |= DECODED_ERROR;
+    sink.onByte(shift, frameStart, flags);
+    haveByte = true;
+    lastByteEnd = frameStart + (10 * bitTime256) / 256;
+    inFrame = false;
+  }
+
+  uint32_t bitTime256; // bit period in 1/256 us
+  uint32_t gapUs;
+  uint32_t frameStart = 0;
+  uint32_t lastByteEnd = 0;
+  uint8_t nextBit = 0;
+  uint8_t shift = 0;
+  bool stopBit = false;
+  bool lastLevel = true;
+  bool haveLevel = false;
+  bool inFrame = false;
+  bool haveByte = false;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Packet framing for the serial transport. Each capture frame is sent as
+//
+//   0x00  COBS(frame + crc16)  0x00
+//
+// COBS removes every zero byte from the body, so 0x00 only ever appears as a
+// delimiter and a reader can resynchronise at the next one after noise, a
+// dropped byte or a log line printed on the same UART. The leading
+// delimiter closes off anything that was written between two packets. The
+// CRC is CRC-16/CCITT-FALSE over the frame, little-endian.
+
+#define LINK_DELIMITER 0x00
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t b) {
+  crc = (uint16_t)((crc >> 8) | (crc << 8));
+  crc ^= b;
+  crc ^= (uint8_t)(crc & 0xFF) >> 4;
+  crc ^= (uint16_t)(crc << 12);
+  crc ^= (uint16_t)((crc & 0xFF) << 5);
+  return crc;
+}
+
+inline uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++)
+    crc = crc16Update(crc, data[i]);
+  return crc;
+}
+
+// Streaming COBS encoder. Sink needs write(const uint8_t *, size_t); both
+// HardwareSerial and the host-side fd writer qualify. Only one 255-byte
+// block is buffered, so frames never need a second, encoded copy in RAM.
+template <class Sink> class LinkWriter {
+public:
+  explicit LinkWriter(Sink &sink) : sink(sink) {}
+
+  void begin() {
+    uint8_t delimiter = LINK_DELIMITER;
+    sink.write(&delimiter, 1);
+    crc = 0xFFFF;
+    blockLength = 0;
+  }
+
+  void write(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      crc = crc16Update(crc, data[i]);
+      put(data[i]);
+    }
+  }
+
+  void end() {
+    put((uint8_t)crc);
+    put((uint8_t)(crc >> 8));
+    flushBlock();
+    uint8_t delimiter = LINK_DELIMITER;
+    sink.write(&delimiter, 1);
+  }
+
+private:
+  void put(uint8_t b) {
+    if (b == 0) {
+      flushBlock();
+      return;
+    }
+    block[1 + blockLength++] = b;
+    if (blockLength == 254) {
+      // A full block carries no implied zero
+      block[0] = 0xFF;
+      sink.write(block, 255);
+      blockLength = 0;
+    }
+  }
+
+  void flushBlock() {
+    block[0] = (uint8_t)(blockLength + 1);
+    sink.write(block, blockLength + 1);
+    blockLength = 0;
+  }
+
+  Sink &sink;
+  uint16_t crc = 0xFFFF;
+  uint8_t block[255];
+  size_t blockLength = 0;
+};
+
+// Streaming COBS decoder with CRC check. Feed it one received byte at a
+// time; push() returns true when a complete, CRC-valid frame is available
+// through frame()/length(). Anything malformed is counted and dropped.
+template <size_t Capacity> class LinkReader {
+public:
+  bool push(uint8_t b) {
+    if (b == LINK_DELIMITER) {
+      bool ok = false;
+      if (discard) {
+        if (len > 0 || remaining > 0)
+          overruns++;
+      } else if (remaining != 0) {
+        malformed++;
+      } else if (len >= 2) {
+        uint16_t expected = (uint16_t)(buf[len - 2] | (buf[len - 1] << 8));
+        if (crc16(buf, len - 2) == expected) {
+          frameLength = len - 2;
+          ok = true;
+        } else {
+          crcErrors++;
+        }
+      } else if (len > 0) {
+        malformed++;
+      }
+      len = 0;
+      remaining = 0;
+      pendingZero = false;
+      discard = false;
+      return ok;
+    }
+
+    if (discard)
+      return false;
+
+    if (remaining == 0) {
+      // Code byte: first emit the zero the previous block stood for
+      if (pendingZero && !append(0))
+        return false;
+      remaining = b - 1;
+      pendingZero = b != 0xFF;
+      return false;
+    }
+
+    append(b);
+    remaining--;
+    return false;
+  }
+
+  const uint8_t *frame() const { return buf; }
+  size_t length() const { return frameLength; }
+
+  uint32_t crcErrors = 0;
+  uint32_t malformed = 0;
+  uint32_t overruns = 0;
+
+private:
+  bool append(uint8_t b) {
+    if (len == Capacity) {
+      discard = true;
+      return false;
+    }
+    buf[len++] = b;
+    return true;
+  }
+
+  uint8_t buf[Capacity];
+  size_t len = 0;
+  size_t frameLength = 0;
+  unsigned remaining = 0;
+  bool pendingZero = false;
+  bool discard = false;
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "capture_frame.h"
+#include "protocol_decoders.h"
+
+// Running statistics over the decoded byte stream. Fed by the same decoders
+// as the byte stream (it is a decoder sink, see protocol_decoders.h), at
+// constant cost per byte, so the board can describe the bus at full rate
+// even when the link only has room for a summary.
+//
+// A summary is STATS_SUMMARY_WORDS u32 words, sent as a FRAME_SUMMARY frame
+// (capture_frame.h) that carries only the non-zero ones; on a quiet bus
+// that is a few dozen bytes rather than 1.3 KB. Counters are cumulative
+// since boot, so a lost summary loses nothing; clients diff two summaries
+// for rates. Word layout is StatsWord below.
+//
+// Gap histograms are log2 buckets of microseconds: bucket 0 is 0 us,
+// bucket i holds [2^(i-1), 2^i) us, the last bucket everything longer.
+// Byte gaps run start to start between consecutive bytes of a transaction;
+// transaction gaps from the last byte of one transaction to the first of
+// the next. Transaction lengths use the same log2 bucketing over bytes.
+//
+// Every time passed in - byte timestamps and advance() - must be on one
+// time base. A build whose samples carry no timestamps (NoClock, see
+// capture_pipeline.h) stamps each byte with the micros() it was decoded at
+// and constructs the stats with timestamped = false: the gap histograms
+// would then measure the decode loop rather than the bus, so they stay
+// empty.
+//
+// The last words describe the link rather than the bus: sample and decoded
+// frame bytes before and after compression (capture_codec.h), and the CPU
+// cycles compression took. Cycles wrap, so diff them as u32.
+
+#define STATS_GAP_BUCKETS 24    // last bucket starts at ~4.2 s
+#define STATS_LENGTH_BUCKETS 16 // last bucket starts at 16 KB
+#define STATS_WINDOW_SECONDS 60
+
+// A transaction still open after this much silence is counted as ended
+#define STATS_TRANSACTION_IDLE_US 100000
+
+enum StatsWord {
+  STATS_TIMESTAMP,     // micros() the summary was taken at
+  STATS_BYTES,         // bytes decoded since boot
+  STATS_TRANSACTIONS,  // transactions started since boot
+  STATS_ERRORS,        // bytes flagged DECODED_ERROR or DECODED_NAK
+  STATS_LOST_SAMPLES,  // samples overwritten before they were decoded
+  STATS_THROUGHPUT_1S, // bytes in the last complete 1 s / 10 s / 60 s
+  STATS_THROUGHPUT_10S,
+  STATS_THROUGHPUT_60S,
+  STATS_BYTE_VALUES,                                    // 256 words
+  STATS_BYTE_GAPS = STATS_BYTE_VALUES + 256,            // STATS_GAP_BUCKETS
+  STATS_TRANSACTION_GAPS = STATS_BYTE_GAPS + STATS_GAP_BUCKETS,
+  STATS_LENGTHS = STATS_TRANSACTION_GAPS + STATS_GAP_BUCKETS,
+  STATS_FRAME_BYTES = STATS_LENGTHS + STATS_LENGTH_BUCKETS, // uncompressed
+  STATS_WIRE_BYTES,     // as sent
+  STATS_ENCODED_FRAMES, // frames the compressor ran on
+  STATS_ENCODE_CYCLES,  // CPU cycles it spent on them
+  STATS_SUMMARY_WORDS,
+};
+
+// Largest summary payload: every word non-zero, five varint bytes each plus
+// a one-byte skip
+#define STATS_SUMMARY_MAX_SIZE (STATS_SUMMARY_WORDS * 6)
+
+inline uint8_t statsBucket(uint32_t v, uint8_t buckets) {
+  uint8_t bucket = v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+  return bucket < buckets ? bucket : (uint8_t)(buckets - 1);
+}
+
+class TrafficStats {
+public:
+  explicit TrafficStats(bool timestamped = true) : timestamped(timestamped) {}
+
+  // Decoder sink
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    advance(timestamp);
+
+    bool start = (flags & DECODED_START) || !inTransaction;
+    if (haveByte && timestamped) {
+      uint32_t gap = timestamp - lastByteTime;
+      if (start)
+        transactionGaps[statsBucket(gap, STATS_GAP_BUCKETS)]++;
+      else
+        byteGaps[statsBucket(gap, STATS_GAP_BUCKETS)]++;
+    }
+    if (start) {
+      endTransaction();
+      inTransaction = true;
+      transactions++;
+    }
+
+    byteValues[value]++;
+    if (flags & (DECODED_NAK | DECODED_ERROR))
+      errors++;
+    totalBytes++;
+    transactionLength++;
+    secondBytes++;
+    lastByteTime = timestamp;
+    haveByte = true;
+  }
+
+  // Rolls the throughput windows forward and closes an idle transaction.
+  // Call periodically with micros() so a quiet bus still reads as quiet.
+  void advance(uint32_t now) {
+    if (!haveSecond) {
+      secondStart = now;
+      haveSecond = true;
+    }
+    // Byte timestamps can trail the micros() readings passed in from
+    // loop(), so a time before the current second counts toward it
+    int32_t elapsed = (int32_t)(now - secondStart);
+    if (elapsed >= 1000000 * STATS_WINDOW_SECONDS) {
+      // Idle for longer than the longest window: everything is zero
+      memset(seconds, 0, sizeof(seconds));
+      secondBytes = 0;
+      sum10 = sum60 = lastSecond = 0;
+      secondStart = now - (uint32_t)elapsed % 1000000;
+    } else {
+      while (elapsed >= 1000000) {
+        closeSecond();
+        secondStart += 1000000;
+        elapsed -= 1000000;
+      }
+    }
+
+    if (inTransaction &&
+        (int32_t)(now - lastByteTime) > STATS_TRANSACTION_IDLE_US)
+      endTransaction();
+  }
+
+  void addLostSamples(uint32_t n) { lostSamples += n; }
+
+  // A sample or decoded frame of frameBytes went out as wireBytes; cycles
+  // is what compressing it cost, if it was run through the compressor
+  void onFrameSent(uint32_t frameBytes, uint32_t wireBytes, bool encoded,
+                   uint32_t cycles) {
+    link[0] += frameBytes;
+    link[1] += wireBytes;
+    link[2] += encoded;
+    link[3] += cycles;
+  }
+
+  // Writes the summary payload of the STATS_SUMMARY_WORDS words taken at
+  // `now` (at most STATS_SUMMARY_MAX_SIZE bytes), returns its length
+  size_t writeSummary(uint8_t *out, uint32_t now) const {
+    uint32_t header[STATS_BYTE_VALUES] = {
+        now,         totalBytes, transactions, errors,
+        lostSamples, lastSecond, sum10,        sum60,
+    };
+    uint8_t *end = out + STATS_SUMMARY_MAX_SIZE;
+    uint32_t skipped = 0;
+    uint8_t *p = out;
+    p = putWords(p, end, skipped, header, STATS_BYTE_VALUES);
+    p = putWords(p, end, skipped, byteValues, 256);
+    p = putWords(p, end, skipped, byteGaps, STATS_GAP_BUCKETS);
+    p = putWords(p, end, skipped, transactionGaps, STATS_GAP_BUCKETS);
+    p = putWords(p, end, skipped, lengths, STATS_LENGTH_BUCKETS);
+    p = putWords(p, end, skipped, link, 4);
+    return p - out;
+  }
+
+private:
+  void endTransaction() {
+    if (inTransaction && transactionLength > 0)
+      lengths[statsBucket(transactionLength, STATS_LENGTH_BUCKETS)]++;
+    inTransaction = false;
+    transactionLength = 0;
+  }
+
+  void closeSecond() {
+    uint8_t tenAgo = (secondIndex + STATS_WINDOW_SECONDS - 10) %
+                     STATS_WINDOW_SECONDS;
+    sum10 += secondBytes - seconds[tenAgo];
+    sum60 += secondBytes - seconds[secondIndex];
+    seconds[secondIndex] = secondBytes;
+    secondIndex = (secondIndex + 1) % STATS_WINDOW_SECONDS;
+    lastSecond = secondBytes;
+    secondBytes = 0;
+  }
+
+  // Appends the non-zero words, counting the zero ones in `skipped`
+  static uint8_t *putWords(uint8_t *out, uint8_t *end, uint32_t &skipped,
+                           const uint32_t *words, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      if (words[i] == 0) {
+        skipped++;
+        continue;
+      }
+      out = framePutVarint(out, end, skipped);
+      out = framePutVarint(out, end, words[i]);
+      skipped = 0;
+    }
+    return out;
+  }
+
+  uint32_t byteValues[256] = {};
+  uint32_t byteGaps[STATS_GAP_BUCKETS] = {};
+  uint32_t transactionGaps[STATS_GAP_BUCKETS] = {};
+  uint32_t lengths[STATS_LENGTH_BUCKETS] = {};
+  uint32_t totalBytes = 0;
+  uint32_t transactions = 0;
+  uint32_t errors = 0;
+  uint32_t lostSamples = 0;
+  uint32_t lastByteTime = 0;
+  uint32_t transactionLength = 0;
+  bool timestamped;
+  bool haveByte = false;
+  bool inTransaction = false;
+
+  // STATS_FRAME_BYTES .. STATS_ENCODE_CYCLES
+  uint32_t link[4] = {};
+
+  // Throughput: bytes per second for the last STATS_WINDOW_SECONDS seconds
+  // in a ring, with the 10 s and 60 s sums kept up to date as it turns
+  uint32_t seconds[STATS_WINDOW_SECONDS] = {};
+  uint32_t secondStart = 0;
+  uint32_t secondBytes = 0;
+  uint32_t lastSecond = 0;
+  uint32_t sum10 = 0;
+  uint32_t sum60 = 0;
+  uint8_t secondIndex = 0;
+  bool haveSecond = false;
+};
+
+// Reads a summary payload of `count` words back into words (zero where
+// nothing was sent); returns false if it is malformed
+inline bool statsReadSummary(const uint8_t *in, size_t len, uint32_t *words,
+                             uint16_t count) {
+  memset(words, 0, (size_t)count * sizeof(uint32_t));
+  const uint8_t *end = in + len;
+  uint32_t i = 0;
+  while (in != end) {
+    uint32_t skipped, word;
+    if (!frameGetVarint(in, end, skipped) || !frameGetVarint(in, end, word) ||
+        skipped >= count - i)
+      return false;
+    i += skipped;
+    words[i++] = word;
+  }
+  return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+
+// A gzipped page living in flash (see scripts/build_web_assets.py)
+struct WebAsset {
+  PGM_P data;
+  size_t length;
+  const char *contentType;
+  const char *etag;
+};
+
+#define WEB_ASSET(name, type)                                                  \
+  WebAsset { (PGM_P)name##_gz, name##_gz_len, type, name##_etag }
+
+// Bytes copied out of flash per write - small enough to live on the stack
+#define WEB_ASSET_CHUNK 512
+
+// ESP8266WebServer drops request headers unless asked to keep them
+inline void collectWebAssetHeaders(ESP8266WebServer &server) {
+  static const char *headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, 1);
+}
+
+// Serve the asset gzip-encoded, answering 304 when the browser already has
+// this exact build. The body is streamed from flash in small chunks with a
+// yield() between them so the WiFi stack keeps running during the transfer.
+inline void sendWebAsset(ESP8266WebServer &server, const WebAsset &asset) {
+  server.sendHeader("ETag", asset.etag);
+  // no-cache = "revalidate every time", which is what makes the 304 path work
+  server.sendHeader("Cache-Control", "no-cache");
+
+  if (server.header("If-None-Match") == asset.etag) {
+    server.send(304);
+    return;
+  }
+
+  server.sendHeader("Content-Encoding", "gzip");
+  server.setContentLength(asset.length);
+  server.send(200, asset.contentType, "");
+
+  for (size_t offset = 0; offset < asset.length; offset += WEB_ASSET_CHUNK) {
+    size_t len = asset.length - offset;
+    if (len > WEB_ASSET_CHUNK)
+      len = WEB_ASSET_CHUNK;
+    server.sendContent_P(asset.data + offset, len);
+    yield();
+  }
+}
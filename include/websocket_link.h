@@ -0,0 +1,389 @@
+#pragma once
+
+// Minimal blocking RFC 6455 WebSocket endpoint for the Linux host tools: a
+// client for the board's port-81 stream and a server side for the replay
+// stand-in. Single messages only up to WS_MAX_MESSAGE, no extensions.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT 0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+#define WS_MAX_MESSAGE (4u << 20)
+
+inline void sha1(const uint8_t *data, size_t len, uint8_t out[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+  std::vector<uint8_t> msg(data, data + len);
+  uint64_t bits = (uint64_t)len * 8;
+  msg.push_back(0x80);
+  while (msg.size() % 64 != 56)
+    msg.push_back(0);
+  for (int i = 7; i >= 0; i--)
+    msg.push_back((uint8_t)(bits >> (i * 8)));
+
+  for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t *p = &msg[chunk + i * 4];
+      w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+             ((uint32_t)p[2] << 8) | p[3];
+    }
+    for (int i = 16; i < 80; i++) {
+      uint32_t v = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+      w[i] = (v << 1) | (v >> 31);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = (b << 30) | (b >> 2);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 5; i++)
+    for (int j = 0; j < 4; j++)
+      out[i * 4 + j] = (uint8_t)(h[i] >> (24 - j * 8));
+}
+
+inline std::string base64Encode(const uint8_t *data, size_t len) {
+  static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (i + 1 < len)
+      v |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < len)
+      v |= data[i + 2];
+    out += table[(v >> 18) & 63];
+    out += table[(v >> 12) & 63];
+    out += i + 1 < len ? table[(v >> 6) & 63] : '=';
+    out += i + 2 < len ? table[v & 63] : '=';
+  }
+  return out;
+}
+
+// Sec-WebSocket-Accept value for a client key
+inline std::string webSocketAccept(const std::string &key) {
+  std::string s = key + "258EAFA5-E914-47DA-95CA-C5AB0DC11B1E";
+  uint8_t digest[20];
+  sha1((const uint8_t *)s.data(), s.size(), digest);
+  return base64Encode(digest, sizeof(digest));
+}
+
+class WebSocketLink {
+public:
+  WebSocketLink() {}
+  ~WebSocketLink() { close(); }
+
+  // Connects to ws://host:port/ and completes the opening handshake.
+  // timeoutMs bounds the connect and every later read: the board sends a
+  // frame every 100 ms, so a silent link is treated as broken.
+  bool connect(const char *host, int port, int timeoutMs = 2000) {
+    close();
+    client = true;
+
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char portString[8];
+    snprintf(portString, sizeof(portString), "%d", port);
+    if (getaddrinfo(host, portString, &hints, &res) != 0)
+      return false;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0)
+        continue;
+      setTimeouts(timeoutMs);
+      if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        break;
+      ::close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+      return false;
+    setNoDelay();
+
+    uint8_t nonce[16];
+    for (auto &b : nonce)
+      b = (uint8_t)rand();
+    std::string key = base64Encode(nonce, sizeof(nonce));
+    std::string request = "GET / HTTP/1.1\r\nHost: " + std::string(host) +
+                          ":" + portString +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " +
+                          key + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!writeAll((const uint8_t *)request.data(), request.size()))
+      return fail();
+
+    std::string response;
+    if (!readHttpHeaders(response) ||
+        response.compare(0, 12, "HTTP/1.1 101") != 0 ||
+        headerValue(response, "Sec-WebSocket-Accept") != webSocketAccept(key))
+      return fail();
+    return true;
+  }
+
+  // Server side: takes ownership of an accepted socket and answers the
+  // client's opening handshake. timeoutMs bounds the handshake and every
+  // later read and write, so a client that connects and then stalls is
+  // dropped instead of holding up the server.
+  bool accept(int socketFd, int timeoutMs = 2000) {
+    close();
+    client = false;
+    fd = socketFd;
+    setTimeouts(timeoutMs);
+    setNoDelay();
+
+    std::string request;
+    if (!readHttpHeaders(request))
+      return fail();
+    std::string key = headerValue(request, "Sec-WebSocket-Key");
+    if (key.empty())
+      return fail();
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " +
+                           webSocketAccept(key) + "\r\n\r\n";
+    if (!writeAll((const uint8_t *)response.data(), response.size()))
+      return fail();
+    return true;
+  }
+
+  // Blocks for the next text or binary message. Pings are answered and
+  // fragments reassembled here. Returns the opcode, or -1 once the
+  // connection is closed or broken.
+  int receive(std::vector<uint8_t> &message) {
+    message.clear();
+    int messageOpcode = -1;
+    while (fd >= 0) {
+      uint8_t head[2];
+      if (!readAll(head, 2))
+        return broken();
+      bool fin = head[0] & 0x80;
+      int opcode = head[0] & 0x0F;
+      bool masked = head[1] & 0x80;
+      uint64_t len = head[1] & 0x7F;
+      if (len == 126) {
+        uint8_t ext[2];
+        if (!readAll(ext, 2))
+          return broken();
+        len = ((uint64_t)ext[0] << 8) | ext[1];
+      } else if (len == 127) {
+        uint8_t ext[8];
+        if (!readAll(ext, 8))
+          return broken();
+        len = 0;
+        for (int i = 0; i < 8; i++)
+          len = (len << 8) | ext[i];
+      }
+      uint8_t mask[4] = {0, 0, 0, 0};
+      if (masked && !readAll(mask, 4))
+        return broken();
+      if (message.size() + len > WS_MAX_MESSAGE)
+        return broken();
+
+      size_t start = message.size();
+      message.resize(start + len);
+      if (len > 0 && !readAll(&message[start], len))
+        return broken();
+      if (masked)
+        for (uint64_t i = 0; i < len; i++)
+          message[start + i] ^= mask[i & 3];
+
+      if (opcode == WS_OP_PING) {
+        std::vector<uint8_t> payload(message.begin() + start, message.end());
+        message.resize(start);
+        send(WS_OP_PONG, payload.data(), payload.size());
+        continue;
+      }
+      if (opcode == WS_OP_PONG) {
+        message.resize(start);
+        continue;
+      }
+      if (opcode == WS_OP_CLOSE) {
+        close();
+        return -1;
+      }
+      if (opcode != WS_OP_CONTINUATION)
+        messageOpcode = opcode;
+      if (fin)
+        return messageOpcode;
+    }
+    return -1;
+  }
+
+  bool send(int opcode, const uint8_t *data, size_t len) {
+    if (fd < 0)
+      return false;
+    uint8_t head[14];
+    size_t headLength = 2;
+    head[0] = (uint8_t)(0x80 | opcode);
+    uint8_t maskBit = client ? 0x80 : 0x00;
+    if (len < 126) {
+      head[1] = (uint8_t)(maskBit | len);
+    } else if (len <= 0xFFFF) {
+      head[1] = maskBit | 126;
+      head[2] = (uint8_t)(len >> 8);
+      head[3] = (uint8_t)len;
+      headLength = 4;
+    } else {
+      head[1] = maskBit | 127;
+      for (int i = 0; i < 8; i++)
+        head[2 + i] = (uint8_t)((uint64_t)len >> (56 - i * 8));
+      headLength = 10;
+    }
+
+    // Clients must mask every frame they send
+    if (!client)
+      return writeAll(head, headLength) && writeAll(data, len);
+    uint8_t mask[4];
+    for (auto &b : mask)
+      b = (uint8_t)rand();
+    memcpy(head + headLength, mask, 4);
+    headLength += 4;
+    std::vector<uint8_t> masked(data, data + len);
+    for (size_t i = 0; i < len; i++)
+      masked[i] ^= mask[i & 3];
+    return writeAll(head, headLength) &&
+           (len == 0 || writeAll(masked.data(), len));
+  }
+
+  bool sendText(const std::string &text) {
+    return send(WS_OP_TEXT, (const uint8_t *)text.data(), text.size());
+  }
+
+  bool isOpen() const { return fd >= 0; }
+
+  void close() {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+private:
+  bool fail() {
+    close();
+    return false;
+  }
+
+  int broken() {
+    close();
+    return -1;
+  }
+
+  void setTimeouts(int timeoutMs) {
+    struct timeval tv = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  }
+
+  void setNoDelay() {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+
+  bool readAll(uint8_t *data, size_t len) {
+    while (len > 0) {
+      ssize_t n = ::recv(fd, data, len, 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      data += n;
+      len -= (size_t)n;
+    }
+    return true;
+  }
+
+  bool writeAll(const uint8_t *data, size_t len) {
+    while (len > 0) {
+      ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      data += n;
+      len -= (size_t)n;
+    }
+    return true;
+  }
+
+  // Reads byte-by-byte up to the blank line so no frame data is consumed
+  bool readHttpHeaders(std::string &headers) {
+    headers.clear();
+    uint8_t c;
+    while (headers.size() < 8192) {
+      if (!readAll(&c, 1))
+        return false;
+      headers += (char)c;
+      if (headers.size() >= 4 &&
+          headers.compare(headers.size() - 4, 4, "\r\n\r\n") == 0)
+        return true;
+    }
+    return false;
+  }
+
+  static std::string headerValue(const std::string &headers,
+                                 const char *name) {
+    size_t nameLength = strlen(name);
+    size_t pos = 0;
+    while ((pos = headers.find("\r\n", pos)) != std::string::npos) {
+      pos += 2;
+      if (strncasecmp(headers.c_str() + pos, name, nameLength) == 0 &&
+          headers[pos + nameLength] == ':') {
+        size_t start = headers.find_first_not_of(' ', pos + nameLength + 1);
+        size_t end = headers.find("\r\n", start);
+        return headers.substr(start, end - start);
+      }
+    }
+    return std::string();
+  }
+
+  int fd = -1;
+  bool client = true;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// Background WiFi bring-up, so capture and the web servers run from the
+// first loop() instead of waiting on the station connection. begin()
+// returns immediately; update() from loop() drives the state machine:
+//
+//   CONNECTING --connected--> CONNECTED --link lost--> CONNECTING
+//       |                                                  ^
+//       +--failed/timeout--> BACKOFF --backoff elapsed-----+
+//
+// The backoff doubles per failed attempt up to WIFI_BACKOFF_MAX_MS. After
+// the first failure a soft AP comes up so the board stays reachable at
+// 192.168.4.1; it is taken down once the station connects and nobody is
+// associated with it. The AP shares the station's radio channel, so its
+// clients may see short drops while the station retries.
+
+#define WIFI_CONNECT_TIMEOUT_MS 10000
+#define WIFI_BACKOFF_MIN_MS 2000
+#define WIFI_BACKOFF_MAX_MS 60000
+
+enum WifiState {
+  WIFI_STATE_CONNECTING,
+  WIFI_STATE_BACKOFF,
+  WIFI_STATE_CONNECTED,
+};
+
+class WifiStartup {
+public:
+  void begin(const char *ssid, const char *password, const char *apSsid,
+             const char *apPassword) {
+    this->ssid = ssid;
+    this->password = password;
+    this->apSsid = apSsid;
+    this->apPassword = apPassword;
+
+    // Retries are ours; don't let the SDK reconnect or write flash behind
+    // our back
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+    backoffMs = WIFI_BACKOFF_MIN_MS;
+    connect();
+  }
+
+  void update() {
+    unsigned long now = millis();
+    wl_status_t status = WiFi.status();
+
+    switch (wifiState) {
+    case WIFI_STATE_CONNECTING:
+      if (status == WL_CONNECTED) {
+        wifiState = WIFI_STATE_CONNECTED;
+        backoffMs = WIFI_BACKOFF_MIN_MS;
+        Serial.print("WiFi connected, IP address: ");
+        Serial.println(WiFi.localIP());
+      } else if (now - stateSince >= WIFI_CONNECT_TIMEOUT_MS ||
+                 status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED ||
+                 status == WL_WRONG_PASSWORD) {
+        Serial.printf("WiFi connection to %s failed (status %d), retrying "
+                      "in %lu ms\n",
+                      ssid, (int)status, backoffMs);
+        WiFi.disconnect();
+        if (!apOn)
+          startAccessPoint();
+        wifiState = WIFI_STATE_BACKOFF;
+        stateSince = now;
+      }
+      break;
+
+    case WIFI_STATE_BACKOFF:
+      if (now - stateSince >= backoffMs) {
+        backoffMs = min(backoffMs * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+        connect();
+      }
+      break;
+
+    case WIFI_STATE_CONNECTED:
+      if (status != WL_CONNECTED) {
+        Serial.println("WiFi connection lost, reconnecting");
+        connect();
+      } else if (apOn && WiFi.softAPgetStationNum() == 0) {
+        stopAccessPoint();
+      }
+      break;
+    }
+  }
+
+  WifiState state() const { return wifiState; }
+  bool accessPointActive() const { return apOn; }
+
+private:
+  void connect() {
+    Serial.printf("Connecting to WiFi: %s\n", ssid);
+    WiFi.begin(ssid, password);
+    wifiState = WIFI_STATE_CONNECTING;
+    stateSince = millis();
+  }
+
+  void startAccessPoint() {
+    WiFi.mode(WIFI_AP_STA);
+    apOn = WiFi.softAP(apSsid, apPassword);
+    if (apOn) {
+      Serial.printf("Access point %s started, IP address: ", apSsid);
+      Serial.println(WiFi.softAPIP());
+    } else {
+      Serial.println("Access point failed to start");
+    }
+  }
+
+  void stopAccessPoint() {
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA);
+    apOn = false;
+    Serial.println("Access point stopped");
+  }
+
+  const char *ssid = nullptr;
+  const char *password = nullptr;
+  const char *apSsid = nullptr;
+  const char *apPassword = nullptr;
+  WifiState wifiState = WIFI_STATE_CONNECTING;
+  unsigned long stateSince = 0;
+  unsigned long backoffMs = WIFI_BACKOFF_MIN_MS;
+  bool apOn = false;
+};
@@ -0,0 +1,90 @@
+# Pre-build step: minify and gzip the frontend pages in web/ into PROGMEM
+# byte arrays under include/generated/, one header per page.
+#
+# Runs automatically from platformio.ini (extra_scripts = pre:...) and can
+# also be invoked by hand: python3 scripts/build_web_assets.py
+
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+OUT_DIR = os.path.join(PROJECT_DIR, "include", "generated")
+
+
+def minify(html):
+    # Conservative: keep line structure so inline JS never depends on
+    # semicolon insertion changing, only drop indentation, blank lines,
+    # whole-line comments and single-line HTML comments.
+    lines = []
+    for line in html.splitlines():
+        line = line.strip()
+        if not line or line.startswith("//"):
+            continue
+        line = re.sub(r"<!--.*?-->", "", line).strip()
+        if line:
+            lines.append(line)
+    return "\n".join(lines) + "\n"
+
+
+def to_c_array(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(rows)
+
+
+def build(page):
+    base = os.path.splitext(page)[0]
+    symbol = re.sub(r"\W", "_", base) + "_html"
+    src_path = os.path.join(WEB_DIR, page)
+    out_path = os.path.join(OUT_DIR, symbol + ".h")
+
+    with open(src_path, "r", encoding="utf-8") as f:
+        source = f.read()
+    minified = minify(source).encode("utf-8")
+    # mtime=0 keeps the output (and therefore the ETag) reproducible
+    compressed = gzip.compress(minified, compresslevel=9, mtime=0)
+    etag = '\\"%s\\"' % hashlib.sha1(compressed).hexdigest()[:16]
+
+    header = """// Generated by scripts/build_web_assets.py from web/{page} - do not edit.
+// {raw} bytes source, {mini} bytes minified, {gz} bytes gzipped.
+#pragma once
+
+#include <pgmspace.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint8_t {sym}_gz[] PROGMEM = {{
+{body}
+}};
+static const size_t {sym}_gz_len = {gz};
+static const char {sym}_etag[] = "{etag}";
+""".format(page=page, raw=len(source.encode("utf-8")), mini=len(minified),
+           gz=len(compressed), sym=symbol, body=to_c_array(compressed),
+           etag=etag)
+
+    # Only touch the header when it changed, so unchanged pages don't force
+    # a rebuild of every firmware that includes them.
+    if os.path.exists(out_path):
+        with open(out_path, "r", encoding="utf-8") as f:
+            if f.read() == header:
+                return
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(header)
+    print("web asset: %s -> %s (%d -> %d bytes)" %
+          (page, os.path.relpath(out_path, PROJECT_DIR), len(minified),
+           len(compressed)))
+
+
+os.makedirs(OUT_DIR, exist_ok=True)
+for page in sorted(os.listdir(WEB_DIR)):
+    if page.endswith(".html"):
+        build(page)
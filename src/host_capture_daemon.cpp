@@ -0,0 +1,688 @@
+// Host-side capture daemon (Linux).
+//
+// Records the frame stream of one or more capture boards into memory-mapped,
+// append-only stores (capture_store.h), decodes SPI, I2C or UART
+// transactions from them (protocol_decoders.h) in a background thread per
+// board, and answers time-range / byte-pattern queries against a store.
+//
+//   host_capture_daemon record <dir> ws://192.168.1.50[:81] serial:/dev/ttyUSB0[@2000000] ... [--protocol spi0]
+//   host_capture_daemon info   <dir>/<source>
+//   host_capture_daemon query  <dir>/<source> [--from T] [--to T] [--pattern HEX] [--limit N]
+//   host_capture_daemon replay <dir>/<source> [--port 81] [--speed X] [--loop]
+//
+// Each source records into its own subdirectory of <dir>. Times T are unix
+// seconds, or +S / -S seconds relative to the start / end of the capture.
+//
+// replay serves a recorded store on a local WebSocket port with the
+// original pacing, standing in for a board: the frontend, or another
+// `record ws://localhost:8181`, can be pointed at it for testing.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture_codec.h"
+#include "capture_frame.h"
+#include "capture_store.h"
+#include "host_serial.h"
+#include "protocol_decoders.h"
+#include "serial_link.h"
+#include "traffic_stats.h"
+#include "websocket_link.h"
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) { stopRequested = true; }
+
+static uint64_t wallClockUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleepMs(unsigned ms) {
+  struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+  nanosleep(&ts, nullptr);
+}
+
+static std::string formatTime(uint64_t timeUs) {
+  time_t seconds = (time_t)(timeUs / 1000000);
+  struct tm tm;
+  localtime_r(&seconds, &tm);
+  char buf[48];
+  size_t n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(buf + n, sizeof(buf) - n, ".%06u", (unsigned)(timeUs % 1000000));
+  return buf;
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+
+struct Source {
+  std::string spec;
+  std::string dir;
+  CaptureStore store;
+  std::atomic<uint64_t> frames{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> lostFrames{0};
+  uint32_t expectedSeq = 0;
+  bool haveSeq = false;
+};
+
+// Directory name for a source spec: ws://10.0.0.5:81 -> 10.0.0.5_81,
+// serial:/dev/ttyUSB0@2000000 -> ttyUSB0
+static std::string sourceDirName(const std::string &spec) {
+  std::string name = spec;
+  size_t scheme = name.find("://");
+  if (scheme != std::string::npos)
+    name = name.substr(scheme + 3);
+  else if (name.compare(0, 7, "serial:") == 0)
+    name = name.substr(7);
+  name = name.substr(0, name.find('@'));
+  size_t slash = name.rfind('/');
+  if (slash != std::string::npos)
+    name = name.substr(slash + 1);
+  for (char &c : name)
+    if (c == ':' || c == '@' || c == '/')
+      c = '_';
+  return name;
+}
+
+static void storeFrame(Source &source, const uint8_t *frame, size_t len) {
+  FrameHeader header;
+  if (!frameReadHeader(frame, len, header))
+    return;
+  // A board reset with the serial port still open starts seq again from 0;
+  // that is a restart, not loss
+  if (source.haveSeq && header.seq < source.expectedSeq) {
+    fprintf(stderr, "%s: board restarted\n", source.spec.c_str());
+    source.haveSeq = false;
+  }
+  if (source.haveSeq && header.seq != source.expectedSeq)
+    source.lostFrames += header.seq - source.expectedSeq;
+  source.expectedSeq = header.seq + 1;
+  source.haveSeq = true;
+
+  if (!source.store.appendFrame(wallClockUs(), frame, (uint32_t)len)) {
+    fprintf(stderr, "%s: store full, stopping\n", source.spec.c_str());
+    stopRequested = true;
+    return;
+  }
+  source.frames++;
+  source.bytes += len;
+}
+
+static void recordWebSocket(Source &source) {
+  std::string hostPort = source.spec.substr(5); // after ws://
+  int port = 81;
+  size_t colon = hostPort.rfind(':');
+  if (colon != std::string::npos) {
+    port = atoi(hostPort.c_str() + colon + 1);
+    hostPort = hostPort.substr(0, colon);
+  }
+
+  WebSocketLink link;
+  std::vector<uint8_t> message;
+  unsigned backoffMs = 500;
+  while (!stopRequested) {
+    if (!link.connect(hostPort.c_str(), port)) {
+      sleepMs(backoffMs);
+      backoffMs = backoffMs < 8000 ? backoffMs * 2 : backoffMs;
+      continue;
+    }
+    fprintf(stderr, "%s: connected\n", source.spec.c_str());
+    backoffMs = 500;
+    source.haveSeq = false;
+
+    int opcode;
+    while (!stopRequested && (opcode = link.receive(message)) >= 0) {
+      if (opcode == WS_OP_BINARY)
+        storeFrame(source, message.data(), message.size());
+    }
+    if (!stopRequested)
+      fprintf(stderr, "%s: disconnected\n", source.spec.c_str());
+  }
+}
+
+static void recordSerial(Source &source) {
+  std::string path = source.spec.substr(7); // after serial:
+  long baud = 2000000;
+  size_t at = path.find('@');
+  if (at != std::string::npos) {
+    baud = atol(path.c_str() + at + 1);
+    path = path.substr(0, at);
+  }
+
+  std::unique_ptr<LinkReader<FRAME_MAX_SIZE + 2>> reader(
+      new LinkReader<FRAME_MAX_SIZE + 2>());
+  uint8_t rx[4096];
+
+  // Reopen after the board is unplugged or reset
+  while (!stopRequested) {
+    int fd = openSerialPort(path.c_str(), baud);
+    if (fd < 0) {
+      sleepMs(2000);
+      continue;
+    }
+    fprintf(stderr, "%s: opened\n", source.spec.c_str());
+    source.haveSeq = false;
+
+    while (!stopRequested) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 200) <= 0)
+        continue;
+      ssize_t n = read(fd, rx, sizeof(rx));
+      if (n <= 0) {
+        if (n < 0 && errno == EINTR)
+          continue;
+        fprintf(stderr, "%s: port closed\n", source.spec.c_str());
+        break;
+      }
+      for (ssize_t i = 0; i < n; i++)
+        if (reader->push(rx[i]))
+          storeFrame(source, reader->frame(), reader->length());
+    }
+    close(fd);
+  }
+}
+
+// Appends decoder output to the store's byte log, opening a new
+// transaction entry on every DECODED_START byte
+struct StoreSink {
+  CaptureStore &store;
+  uint64_t frameTimeUs;     // host time the current frame arrived
+  uint32_t frameTimestamp;  // device time of its last sample
+  std::vector<uint8_t> pending;
+
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    if (flags & DECODED_START) {
+      flush();
+      // Device timestamps are micros(); place them relative to the frame's
+      // host receive time
+      store.beginTransaction(frameTimeUs - (uint32_t)(frameTimestamp - timestamp));
+    }
+    pending.push_back(value);
+  }
+
+  void flush() {
+    if (!pending.empty()) {
+      store.appendBytes(pending.data(), pending.size());
+      pending.clear();
+    }
+  }
+};
+
+// Frames are stored as received; compressed ones are expanded into
+// `expanded` for decoding
+// `expectedSeq` follows every stored frame; when a frame is missing or the
+// board restarted, the decoder's mid-byte state is dropped before going on.
+template <class Decoder>
+static void decodeFrame(CaptureStore &store, uint64_t i, Decoder &decoder,
+                        StoreSink &sink, std::vector<uint8_t> &expanded,
+                        uint32_t &expectedSeq) {
+  uint32_t len;
+  const uint8_t *frame = store.frameData(i, len);
+  FrameHeader header;
+  if (!frameReadHeader(frame, len, header))
+    return;
+  if (header.seq != expectedSeq)
+    decoder.reset();
+  expectedSeq = header.seq + 1;
+  if (header.type != FRAME_SAMPLES || header.count == 0)
+    return;
+  if (header.flags & FRAME_FLAG_COMPRESSED) {
+    len = (uint32_t)frameExpand(frame, len, expanded.data(), expanded.size());
+    if (len == 0)
+      return;
+    frame = expanded.data();
+  }
+
+  sink.frameTimeUs = store.frameEntry(i).timeUs;
+  sink.frameTimestamp = frameReadSample(frame, header.count - 1).timestamp;
+  for (uint16_t s = 0; s < header.count; s++) {
+    FrameSample sample = frameReadSample(frame, s);
+    decoder.feed(sample.data, sample.timestamp, sink);
+  }
+  decoder.flush(sink.frameTimestamp, sink);
+  sink.flush();
+}
+
+// Follows frames.idx and decodes every new frame into bytes.log/bytes.idx.
+// One instantiation per protocol, so the per-sample loop has no dispatch.
+template <class Decoder>
+static void decodeLoop(Source &source, Decoder decoder) {
+  CaptureStore &store = source.store;
+  StoreSink sink = {store, 0, 0, {}};
+  std::vector<uint8_t> expanded(FRAME_MAX_SIZE);
+  uint64_t next = store.decodedFrames();
+  uint32_t expectedSeq = 0;
+
+  for (;;) {
+    uint64_t available = store.frameCount();
+    if (next == available) {
+      if (stopRequested)
+        break;
+      sleepMs(10);
+      continue;
+    }
+    for (; next < available; next++)
+      decodeFrame(store, next, decoder, sink, expanded, expectedSeq);
+    store.setDecodedFrames(next);
+  }
+}
+
+// Starts the decoder thread for a protocol name: spi0..spi3, i2c or
+// uart[:baud]
+static bool startDecoder(std::vector<std::thread> &threads, Source &source,
+                         const std::string &protocol, uint32_t gapUs) {
+  if (protocol == "spi0" || protocol == "spi")
+    threads.emplace_back(decodeLoop<SpiDecoder<0>>, std::ref(source),
+                         SpiDecoder<0>(gapUs));
+  else if (protocol == "spi1")
+    threads.emplace_back(decodeLoop<SpiDecoder<1>>, std::ref(source),
+                         SpiDecoder<1>(gapUs));
+  else if (protocol == "spi2")
+    threads.emplace_back(decodeLoop<SpiDecoder<2>>, std::ref(source),
+                         SpiDecoder<2>(gapUs));
+  else if (protocol == "spi3")
+    threads.emplace_back(decodeLoop<SpiDecoder<3>>, std::ref(source),
+                         SpiDecoder<3>(gapUs));
+  else if (protocol == "i2c")
+    threads.emplace_back(decodeLoop<I2cDecoder>, std::ref(source),
+                         I2cDecoder());
+  else if (protocol.compare(0, 4, "uart") == 0) {
+    uint32_t baud = protocol.size() > 5 ? (uint32_t)atol(protocol.c_str() + 5)
+                                        : 115200;
+    if (baud == 0)
+      return false;
+    threads.emplace_back(decodeLoop<UartDecoder<>>, std::ref(source),
+                         UartDecoder<>(baud));
+  } else
+    return false;
+  return true;
+}
+
+static int runRecord(const std::string &dir, const std::vector<std::string> &specs,
+                     const std::string &protocol, uint32_t gapUs) {
+  mkdir(dir.c_str(), 0755);
+  std::vector<std::unique_ptr<Source>> sources;
+  for (const std::string &spec : specs) {
+    if (spec.compare(0, 5, "ws://") != 0 && spec.compare(0, 7, "serial:") != 0) {
+      fprintf(stderr, "Unknown source %s\n", spec.c_str());
+      return 2;
+    }
+    std::unique_ptr<Source> source(new Source());
+    source->spec = spec;
+    source->dir = dir + "/" + sourceDirName(spec);
+    if (!source->store.open(source->dir, true))
+      return 1;
+    fprintf(stderr, "%s -> %s\n", spec.c_str(), source->dir.c_str());
+    sources.push_back(std::move(source));
+  }
+
+  std::vector<std::thread> threads;
+  for (auto &source : sources) {
+    Source *s = source.get();
+    if (s->spec.compare(0, 5, "ws://") == 0)
+      threads.emplace_back(recordWebSocket, std::ref(*s));
+    else
+      threads.emplace_back(recordSerial, std::ref(*s));
+    if (!startDecoder(threads, *s, protocol, gapUs)) {
+      fprintf(stderr, "Unknown protocol %s\n", protocol.c_str());
+      stopRequested = true;
+      break;
+    }
+  }
+
+  // Per-second throughput report
+  std::vector<uint64_t> lastBytes(sources.size(), 0);
+  while (!stopRequested) {
+    sleepMs(1000);
+    for (size_t i = 0; i < sources.size(); i++) {
+      Source &s = *sources[i];
+      uint64_t bytes = s.bytes;
+      fprintf(stderr, "%s: %llu frames  %.1f KB/s  lost %llu  decoded %llu transactions\n",
+              s.spec.c_str(), (unsigned long long)s.frames.load(),
+              (bytes - lastBytes[i]) / 1024.0,
+              (unsigned long long)s.lostFrames.load(),
+              (unsigned long long)s.store.transactionCount());
+      lastBytes[i] = bytes;
+    }
+  }
+
+  // Receivers notice within their read timeout; decoders drain what was
+  // recorded before exiting
+  for (auto &t : threads)
+    t.join();
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+
+static bool parseTime(const char *arg, uint64_t startUs, uint64_t endUs,
+                      uint64_t &out) {
+  char *end;
+  double v = strtod(arg, &end);
+  if (*end != '\0')
+    return false;
+  if (arg[0] == '+')
+    out = startUs + (uint64_t)(v * 1e6);
+  else if (arg[0] == '-')
+    out = endUs - (uint64_t)(-v * 1e6);
+  else
+    out = (uint64_t)(v * 1e6);
+  return true;
+}
+
+static bool parseHex(const char *arg, std::vector<uint8_t> &out) {
+  std::string hex;
+  for (const char *p = arg; *p; p++)
+    if (*p != ' ' && *p != ':')
+      hex += *p;
+  if (hex.size() % 2 != 0 || hex.empty())
+    return false;
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    char byte[3] = {hex[i], hex[i + 1], 0};
+    char *end;
+    out.push_back((uint8_t)strtoul(byte, &end, 16));
+    if (*end != '\0')
+      return false;
+  }
+  return true;
+}
+
+static void printTransaction(const CaptureStore &store, uint64_t t) {
+  uint64_t begin, end;
+  store.transactionRange(t, begin, end);
+  printf("%s  %5llu  ", formatTime(store.transactionEntry(t).timeUs).c_str(),
+         (unsigned long long)(end - begin));
+  for (uint64_t i = begin; i < end && i < begin + 32; i++)
+    printf("%02X ", store.byteData()[i]);
+  if (end - begin > 32)
+    printf("...");
+  printf("\n");
+}
+
+static int runInfo(const std::string &dir) {
+  CaptureStore store;
+  if (!store.open(dir, false))
+    return 1;
+  uint64_t frames = store.frameCount();
+  printf("frames        %llu\n", (unsigned long long)frames);
+  if (frames > 0) {
+    printf("first         %s\n", formatTime(store.frameEntry(0).timeUs).c_str());
+    printf("last          %s\n",
+           formatTime(store.frameEntry(frames - 1).timeUs).c_str());
+  }
+  printf("frame bytes   %llu\n", (unsigned long long)store.frames.size());
+
+  // Compression: what the stored frames expand to, and what compressing
+  // cost the board between its last two summaries
+  std::vector<uint8_t> expanded(FRAME_MAX_SIZE);
+  uint64_t compressed = 0, wireBytes = 0, rawBytes = 0;
+  std::vector<uint32_t> summary, previousSummary;
+  for (uint64_t i = 0; i < frames; i++) {
+    uint32_t len;
+    const uint8_t *frame = store.frameData(i, len);
+    FrameHeader header;
+    if (!frameReadHeader(frame, len, header))
+      continue;
+    if (header.type == FRAME_SUMMARY && header.count >= STATS_SUMMARY_WORDS) {
+      std::vector<uint32_t> words(header.count);
+      if (statsReadSummary(frame + FRAME_HEADER_SIZE, len - FRAME_HEADER_SIZE,
+                           words.data(), header.count)) {
+        previousSummary.swap(summary);
+        summary.swap(words);
+      }
+    }
+    if (!(header.flags & FRAME_FLAG_COMPRESSED))
+      continue;
+    compressed++;
+    wireBytes += len;
+    rawBytes += frameExpand(frame, len, expanded.data(), expanded.size());
+  }
+  if (compressed > 0)
+    printf("compressed    %llu frames, %.2fx\n", (unsigned long long)compressed,
+           (double)rawBytes / (double)wireBytes);
+  if (!previousSummary.empty()) {
+    // Counters are cumulative and wrap, so diff them as u32
+    uint32_t delta[4];
+    for (int w = 0; w < 4; w++)
+      delta[w] = summary[STATS_FRAME_BYTES + w] -
+                 previousSummary[STATS_FRAME_BYTES + w];
+    if (delta[2] > 0 && delta[1] > 0)
+      printf("board codec   %.2fx, %u cycles per frame\n",
+             (double)delta[0] / delta[1], delta[3] / delta[2]);
+  }
+  printf("decoded       %llu frames\n", (unsigned long long)store.decodedFrames());
+  printf("transactions  %llu\n", (unsigned long long)store.transactionCount());
+  printf("bytes         %llu\n", (unsigned long long)store.bytes.size());
+  return 0;
+}
+
+static int runQuery(const std::string &dir, const char *from, const char *to,
+                    const char *pattern, uint64_t limit) {
+  CaptureStore store;
+  if (!store.open(dir, false))
+    return 1;
+  uint64_t count = store.transactionCount();
+  if (count == 0)
+    return 0;
+
+  const IndexEntry *entries = (const IndexEntry *)store.byteIndex.data();
+  uint64_t startUs = entries[0].timeUs;
+  uint64_t endUs = entries[count - 1].timeUs;
+  uint64_t fromUs = 0, toUs = UINT64_MAX;
+  if ((from && !parseTime(from, startUs, endUs, fromUs)) ||
+      (to && !parseTime(to, startUs, endUs, toUs))) {
+    fprintf(stderr, "Bad time\n");
+    return 2;
+  }
+
+  uint64_t first = lowerBoundByTime(entries, count, fromUs);
+  uint64_t last = lowerBoundByTime(entries, count, toUs == UINT64_MAX ? toUs : toUs + 1);
+  if (first >= last)
+    return 0;
+
+  if (!pattern) {
+    for (uint64_t t = first; t < last && t - first < limit; t++)
+      printTransaction(store, t);
+    return 0;
+  }
+
+  std::vector<uint8_t> needle;
+  if (!parseHex(pattern, needle)) {
+    fprintf(stderr, "Bad pattern\n");
+    return 2;
+  }
+
+  // Search the whole byte range at once so matches spanning transactions
+  // are found too, then map each hit back to its transaction
+  uint64_t begin, end, unused;
+  store.transactionRange(first, begin, unused);
+  store.transactionRange(last - 1, unused, end);
+  const uint8_t *bytes = store.byteData();
+  const uint8_t *p = bytes + begin;
+  const uint8_t *stop = bytes + end;
+  uint64_t matches = 0;
+  uint64_t t = first;
+  while (matches < limit &&
+         (p = (const uint8_t *)memmem(p, stop - p, needle.data(), needle.size()))) {
+    uint64_t offset = p - bytes;
+    uint64_t tBegin, tEnd;
+    for (store.transactionRange(t, tBegin, tEnd); offset >= tEnd && t + 1 < last;
+         store.transactionRange(++t, tBegin, tEnd))
+      ;
+    printf("@%llu  ", (unsigned long long)offset);
+    printTransaction(store, t);
+    matches++;
+    p++;
+  }
+  fprintf(stderr, "%llu matches\n", (unsigned long long)matches);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Replay stand-in
+
+static int runReplay(const std::string &dir, int port, double speed, bool loop) {
+  CaptureStore store;
+  if (!store.open(dir, false))
+    return 1;
+  if (store.frameCount() == 0) {
+    fprintf(stderr, "Store is empty\n");
+    return 1;
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons((uint16_t)port);
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(listener, 4) != 0) {
+    perror("listen");
+    return 1;
+  }
+  fprintf(stderr, "Replaying %llu frames on ws://localhost:%d\n",
+          (unsigned long long)store.frameCount(), port);
+
+  while (!stopRequested) {
+    struct pollfd pfd = {listener, POLLIN, 0};
+    if (poll(&pfd, 1, 200) <= 0)
+      continue;
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    // A client that stalls in the handshake or stops reading is dropped
+    // after the link's timeout, so it cannot block the next one
+    WebSocketLink link;
+    if (!link.accept(fd)) {
+      fprintf(stderr, "Client dropped during handshake\n");
+      continue;
+    }
+    fprintf(stderr, "Client connected\n");
+
+    uint32_t len;
+    FrameHeader header;
+    const uint8_t *frame = store.frameData(0, len);
+    uint32_t bufferSize = frameReadHeader(frame, len, header) ? header.bufferSize : 0;
+    link.sendText("{\"status\":\"connected\",\"bufferSize\":" +
+                  std::to_string(bufferSize) + "}");
+
+    do {
+      uint64_t recordStart = store.frameEntry(0).timeUs;
+      uint64_t replayStart = wallClockUs();
+      for (uint64_t i = 0; i < store.frameCount() && link.isOpen() && !stopRequested; i++) {
+        uint64_t due = replayStart +
+                       (uint64_t)((store.frameEntry(i).timeUs - recordStart) / speed);
+        uint64_t now = wallClockUs();
+        if (due > now)
+          sleepMs((unsigned)((due - now) / 1000));
+        frame = store.frameData(i, len);
+        if (!link.send(WS_OP_BINARY, frame, len)) {
+          link.close();
+          break;
+        }
+      }
+    } while (loop && link.isOpen() && !stopRequested);
+    fprintf(stderr, "Replay finished\n");
+  }
+  close(listener);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s record <dir> <ws://host[:port]|serial:/dev/tty[@baud]>...\n"
+          "              [--protocol spi0..spi3|i2c|uart[:baud]] [--gap us]\n"
+          "       %s info <store>\n"
+          "       %s query <store> [--from T] [--to T] [--pattern HEX] [--limit N]\n"
+          "       %s replay <store> [--port 8181] [--speed X] [--loop]\n",
+          argv0, argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    usage(argv[0]);
+    return 2;
+  }
+  std::string command = argv[1];
+  std::string dir = argv[2];
+
+  std::vector<std::string> sources;
+  const char *from = nullptr, *to = nullptr, *pattern = nullptr;
+  uint64_t limit = UINT64_MAX;
+  uint32_t gapUs = DECODER_DEFAULT_GAP_US;
+  std::string protocol = "spi0";
+  int port = 8181;
+  double speed = 1.0;
+  bool loop = false;
+
+  for (int i = 3; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--from" && hasValue)
+      from = argv[++i];
+    else if (arg == "--to" && hasValue)
+      to = argv[++i];
+    else if (arg == "--pattern" && hasValue)
+      pattern = argv[++i];
+    else if (arg == "--limit" && hasValue)
+      limit = strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--protocol" && hasValue)
+      protocol = argv[++i];
+    else if (arg == "--gap" && hasValue)
+      gapUs = (uint32_t)atol(argv[++i]);
+    else if (arg == "--port" && hasValue)
+      port = atoi(argv[++i]);
+    else if (arg == "--speed" && hasValue)
+      speed = atof(argv[++i]);
+    else if (arg == "--loop")
+      loop = true;
+    else if (arg.compare(0, 2, "--") != 0 && command == "record")
+      sources.push_back(arg);
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (command == "record" && !sources.empty())
+    return runRecord(dir, sources, protocol, gapUs);
+  if (command == "info")
+    return runInfo(dir);
+  if (command == "query")
+    return runQuery(dir, from, to, pattern, limit);
+  if (command == "replay" && speed > 0)
+    return runReplay(dir, port, speed, loop);
+  usage(argv[0]);
+  return 2;
+}
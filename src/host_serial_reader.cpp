@@ -0,0 +1,268 @@
+// Host-side reader for the serial capture transport (Linux).
+//
+// Reads COBS/CRC packets (serial_link.h) from the capture board's USB serial
+// port, validates the capture frames inside (capture_frame.h) and appends
+// them to a capture file. Firmware side: build the capture_receiver_serial
+// environment.
+//
+//   host_serial_reader /dev/ttyUSB0 -b 2000000 -o capture.bin
+//
+// Capture file: a sequence of records, each a little-endian u32 frame
+// length followed by the frame bytes exactly as sent by the board
+// (compressed frames stay compressed, see capture_codec.h).
+//
+// --emit writes synthetic frames instead, acting as a stand-in board. With
+// a pty pair this exercises the whole path without hardware:
+//
+//   socat -d -d pty,raw,echo=0 pty,raw,echo=0   # prints two /dev/pts/N
+//   host_serial_reader --emit /dev/pts/3 -n 1000 &
+//   host_serial_reader /dev/pts/4 -o capture.bin
+//
+// -z makes the emitter compress its frames like a CAPTURE_COMPRESSION build.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_codec.h"
+#include "capture_frame.h"
+#include "host_serial.h"
+#include "protocol_decoders.h"
+#include "serial_link.h"
+
+// Largest possible frame plus its CRC
+static LinkReader<FRAME_MAX_SIZE + 2> linkReader;
+
+// Compressed frames are expanded here to check them and measure the ratio
+static uint8_t expanded[FRAME_MAX_SIZE];
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int runReader(const char *path, long baud, const char *outPath) {
+  int fd = openSerialPort(path, baud);
+  if (fd < 0)
+    return 1;
+
+  FILE *out = nullptr;
+  if (outPath) {
+    out = fopen(outPath, "ab");
+    if (!out) {
+      perror(outPath);
+      return 1;
+    }
+  }
+
+  uint32_t frames = 0, samples = 0, decodedBytes = 0, lostFrames = 0;
+  uint32_t badFrames = 0;
+  uint64_t compressedFrames = 0, wireBytes = 0, rawBytes = 0;
+  uint32_t expectedSeq = 0;
+  bool haveSeq = false;
+  double lastReport = nowSeconds();
+  uint8_t rx[4096];
+
+  while (!stopRequested) {
+    ssize_t n = read(fd, rx, sizeof(rx));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("read");
+      break;
+    }
+    if (n == 0)
+      break;
+
+    for (ssize_t i = 0; i < n; i++) {
+      if (!linkReader.push(rx[i]))
+        continue;
+
+      FrameHeader header;
+      if (!frameReadHeader(linkReader.frame(), linkReader.length(), header)) {
+        badFrames++;
+        continue;
+      }
+      if (header.flags & FRAME_FLAG_COMPRESSED) {
+        size_t rawLength = frameExpand(linkReader.frame(), linkReader.length(),
+                                       expanded, sizeof(expanded));
+        if (rawLength == 0) {
+          badFrames++;
+          continue;
+        }
+        compressedFrames++;
+        wireBytes += linkReader.length();
+        rawBytes += rawLength;
+      }
+      // A board reset with the port still open starts seq again from 0
+      if (haveSeq && header.seq < expectedSeq) {
+        fprintf(stderr, "Board restarted (seq %u, expected %u)\n",
+                header.seq, expectedSeq);
+        haveSeq = false;
+      }
+      if (haveSeq && header.seq != expectedSeq)
+        lostFrames += header.seq - expectedSeq;
+      expectedSeq = header.seq + 1;
+      haveSeq = true;
+      frames++;
+      // Only sample frames count samples; summary records are words
+      if (header.type == FRAME_SAMPLES)
+        samples += header.count;
+      else if (header.type == FRAME_DECODED)
+        decodedBytes += header.count;
+
+      if (out) {
+        uint8_t length[4];
+        framePutU32(length, (uint32_t)linkReader.length());
+        fwrite(length, 1, sizeof(length), out);
+        fwrite(linkReader.frame(), 1, linkReader.length(), out);
+      }
+    }
+
+    double now = nowSeconds();
+    if (now - lastReport >= 1.0) {
+      fprintf(stderr,
+              "frames %u  samples %u  decoded %u  lost %u  bad %u  "
+              "crc errors %u  malformed %u\n",
+              frames, samples, decodedBytes, lostFrames, badFrames,
+              linkReader.crcErrors, linkReader.malformed);
+      if (compressedFrames > 0)
+        fprintf(stderr, "compressed %llu  ratio %.2fx\n",
+                (unsigned long long)compressedFrames,
+                (double)rawBytes / (double)wireBytes);
+      lastReport = now;
+    }
+  }
+
+  fprintf(stderr,
+          "done: frames %u  samples %u  decoded %u  lost %u  bad %u  "
+          "crc errors %u  malformed %u  overruns %u\n",
+          frames, samples, decodedBytes, lostFrames, badFrames,
+          linkReader.crcErrors, linkReader.malformed, linkReader.overruns);
+  if (out)
+    fclose(out);
+  close(fd);
+  return 0;
+}
+
+// Stand-in board: an incrementing byte pattern clocked out as SPI mode 0,
+// MSB first - two samples (falling and rising SCK edge) per bit, the same
+// shape the capture receiver produces.
+static int runEmitter(const char *path, long baud, long frameCount,
+                      bool compress) {
+  int fd = openSerialPort(path, baud);
+  if (fd < 0)
+    return 1;
+
+  const uint16_t samplesPerFrame = 256;
+  static uint8_t frame[FRAME_HEADER_SIZE + 256 * FRAME_SAMPLE_SIZE];
+  static uint8_t encoded[sizeof(frame)];
+  SampleEncoder encoder;
+  FdSink sink = {fd};
+  LinkWriter<FdSink> writer(sink);
+
+  uint32_t sampleCount = 0;
+  uint32_t timestamp = 0;
+  for (long seq = 0; !stopRequested && (frameCount < 0 || seq < frameCount);
+       seq++) {
+    FrameHeader header;
+    header.type = FRAME_SAMPLES;
+    header.flags = 0;
+    header.seq = (uint32_t)seq;
+    header.baudRate = 1000000;
+    header.bufferSize = 1024;
+    header.samplesAvailable = samplesPerFrame;
+    header.count = samplesPerFrame;
+
+    size_t len = FRAME_HEADER_SIZE;
+    encoder.begin(encoded + FRAME_HEADER_SIZE, sizeof(encoded) - len);
+    for (uint16_t i = 0; i < samplesPerFrame; i++) {
+      uint32_t bitIndex = sampleCount / 2;
+      uint8_t value = (uint8_t)(bitIndex / 8);
+      uint8_t bit = (value >> (7 - bitIndex % 8)) & 1;
+      uint8_t clock = (sampleCount & 1) ? LINE_CLOCK : 0;
+      len += frameWriteSample(frame + len, bit | clock, timestamp);
+      encoder.add(bit | clock, timestamp);
+      sampleCount++;
+      timestamp += 1;
+    }
+    header.sampleCount = sampleCount;
+    frameWriteHeader(frame, header);
+
+    const uint8_t *out = frame;
+    size_t payload = encoder.finish();
+    if (compress && payload > 0 && FRAME_HEADER_SIZE + payload < len) {
+      header.flags |= FRAME_FLAG_COMPRESSED;
+      frameWriteHeader(encoded, header);
+      out = encoded;
+      len = FRAME_HEADER_SIZE + payload;
+    }
+
+    writer.begin();
+    writer.write(out, len);
+    writer.end();
+  }
+
+  tcdrain(fd);
+  close(fd);
+  return 0;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s <device> [-b baud] [-o capture.bin]\n"
+          "       %s --emit <device> [-b baud] [-n frames] [-z]\n",
+          argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *device = nullptr;
+  const char *outPath = nullptr;
+  long baud = 2000000;
+  long frameCount = -1;
+  bool emit = false;
+  bool compress = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--emit") == 0) {
+      emit = true;
+    } else if (strcmp(argv[i], "-z") == 0) {
+      compress = true;
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      baud = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      frameCount = atol(argv[++i]);
+    } else if (argv[i][0] != '-' && !device) {
+      device = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!device) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // No SA_RESTART, so a blocking read() returns and the loop can stop
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  return emit ? runEmitter(device, baud, frameCount, compress)
+              : runReader(device, baud, outPath);
+}
@@ -3,441 +3,309 @@
 #include <ESP8266WiFi.h>
 #include <WebSocketsServer.h>
 
+#include "capture_arena.h"
+#include "capture_codec.h"
+#include "capture_frame.h"
+#include "capture_pipeline.h"
+#include "generated/capture_receiver_html.h"
+#include "protocol_decoders.h"
+#include "serial_link.h"
+#include "traffic_stats.h"
+#include "web_asset.h"
+#include "wifi_startup.h"
+
 // WiFi credentials - UPDATE THESE
 const char *ssid = "Villa 1";
 const char *password = "66669999";
 
+// Fallback access point, started while the network above is unreachable
+const char *apSsid = "dream-capture";
+const char *apPassword = "dreamcapture";
+WifiStartup wifi;
+
 // Web server on port 80, WebSocket server on port 81
 ESP8266WebServer server(80);
 WebSocketsServer webSocket(81);
 
-// SPI Pin Configuration
-// NodeMCU v2 pins: D5=GPIO14 (SCK), D6=GPIO12 (MISO)
-const int SPI_SCK_PIN = 14;  // D5 - Clock pin (interrupt on this)
-const int SPI_MISO_PIN = 12; // D6 - Data pin (read on clock edge)
-
-// Circular Buffer Configuration (1KB = 1024 bytes)
-#define BUFFER_SIZE 1024
-
-// Data structure for captured samples
-struct Sample {
-  uint8_t data;            // MISO data bit (0 or 1)
-  unsigned long timestamp; // Microsecond timestamp
+// Capture pipeline, chosen per build environment (see platformio.ini).
+// Pins, timestamp source and protocol decoder are fixed at compile time
+// (see capture_pipeline.h); the ring takes whatever heap is free at startup
+// (see capture_arena.h). Decoded bytes are streamed alongside the raw
+// samples.
+struct CaptureConfig : DefaultCaptureConfig {
+#if defined(CAPTURE_PROTOCOL_I2C)
+  // Bytes are framed by START/STOP, so the ISR can skip reading the clock
+  typedef NoClock Clock;
+  typedef I2cDecoder Decoder;
+  static Decoder makeDecoder() { return Decoder(); }
+#elif defined(CAPTURE_PROTOCOL_UART)
+#ifndef CAPTURE_UART_BAUD
+#define CAPTURE_UART_BAUD 115200
+#endif
+  // Only RX is decoded
+  static constexpr uint8_t kChannelMask = LINE_DATA;
+  typedef UartDecoder<> Decoder;
+  static Decoder makeDecoder() { return Decoder(CAPTURE_UART_BAUD); }
+#else
+#ifndef CAPTURE_SPI_MODE
+#define CAPTURE_SPI_MODE 0
+#endif
+  typedef SpiDecoder<CAPTURE_SPI_MODE> Decoder;
+  static Decoder makeDecoder() { return Decoder(); }
+#endif
 };
 
-// Circular buffer
-volatile Sample buffer[BUFFER_SIZE];
-volatile uint16_t bufferHead = 0; // Write pointer
-volatile uint16_t bufferTail = 0; // Read pointer
-volatile bool bufferOverflow = false;
-
-// Interrupt handling variables
-volatile unsigned long lastClockTime = 0;
-volatile unsigned long lastSampleTime = 0;
-volatile uint32_t sampleCount = 0;
-
-// HTML page for frontend
-const char *htmlPage = R"HTML(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>SPI Logic Analyzer - Capture Board</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body { 
-            font-family: 'Courier New', monospace; 
-            background: #1e1e1e; 
-            color: #d4d4d4; 
-            padding: 20px;
-        }
-        .container { 
-            max-width: 1400px; 
-            margin: 0 auto; 
-        }
-        h1 { 
-            color: #4ec9b0; 
-            margin-bottom: 20px; 
-            text-align: center;
-        }
-        .status-bar {
-            background: #252526;
-            padding: 15px;
-            border-radius: 5px;
-            margin-bottom: 20px;
-            display: grid;
-            grid-template-columns: repeat(auto-fit, minmax(200px, 1fr));
-            gap: 15px;
-        }
-        .status-item {
-            background: #2d2d30;
-            padding: 10px;
-            border-radius: 3px;
-        }
-        .status-label {
-            color: #858585;
-            font-size: 12px;
-            text-transform: uppercase;
-        }
-        .status-value {
-            color: #4ec9b0;
-            font-size: 18px;
-            font-weight: bold;
-            margin-top: 5px;
-        }
-        .status-value.error { color: #f48771; }
-        .status-value.warning { color: #dcdcaa; }
-        .hex-display {
-            background: #252526;
-            padding: 15px;
-            border-radius: 5px;
-            margin-bottom: 20px;
-            max-height: 400px;
-            overflow-y: auto;
-        }
-        .hex-line {
-            font-family: 'Courier New', monospace;
-            font-size: 14px;
-            line-height: 1.6;
-            padding: 2px 0;
-            border-bottom: 1px solid #3e3e42;
-        }
-        .hex-line:hover {
-            background: #2d2d30;
-        }
-        .hex-address {
-            color: #569cd6;
-            display: inline-block;
-            width: 80px;
-        }
-        .hex-data {
-            color: #ce9178;
-            display: inline-block;
-            width: 400px;
-            word-spacing: 8px;
-        }
-        .hex-ascii {
-            color: #858585;
-            display: inline-block;
-            margin-left: 20px;
-        }
-        .connection-status {
-            position: fixed;
-            top: 10px;
-            right: 10px;
-            padding: 10px 20px;
-            border-radius: 5px;
-            font-weight: bold;
-        }
-        .connected { background: #4ec9b0; color: #1e1e1e; }
-        .disconnected { background: #f48771; color: #1e1e1e; }
-        .controls {
-            background: #252526;
-            padding: 15px;
-            border-radius: 5px;
-            margin-bottom: 20px;
-        }
-        button {
-            background: #0e639c;
-            color: white;
-            border: none;
-            padding: 10px 20px;
-            border-radius: 3px;
-            cursor: pointer;
-            font-size: 14px;
-            margin-right: 10px;
-        }
-        button:hover { background: #1177bb; }
-        button:active { background: #0a4f75; }
-        .info {
-            background: #2d2d30;
-            padding: 15px;
-            border-radius: 5px;
-            margin-top: 20px;
-            color: #858585;
-            font-size: 12px;
-        }
-    </style>
-</head>
-<body>
-    <div class="connection-status disconnected" id="connectionStatus">Disconnected</div>
-    <div class="container">
-        <h1>SPI Logic Analyzer - Capture Board</h1>
-        
-        <div class="status-bar">
-            <div class="status-item">
-                <div class="status-label">Baud Rate</div>
-                <div class="status-value" id="baudRate">0 Hz</div>
-            </div>
-            <div class="status-item">
-                <div class="status-label">Sample Count</div>
-                <div class="status-value" id="sampleCount">0</div>
-            </div>
-            <div class="status-item">
-                <div class="status-label">Buffer Usage</div>
-                <div class="status-value" id="bufferUsage">0%</div>
-            </div>
-            <div class="status-item">
-                <div class="status-label">Samples Available</div>
-                <div class="status-value" id="samplesAvailable">0</div>
-            </div>
-            <div class="status-item">
-                <div class="status-label">Buffer Overflow</div>
-                <div class="status-value" id="overflow">No</div>
-            </div>
-        </div>
-        
-        <div class="controls">
-            <button onclick="clearDisplay()">Clear Display</button>
-            <button onclick="toggleAutoScroll()" id="autoScrollBtn">Auto Scroll: ON</button>
-        </div>
-        
-        <div class="hex-display" id="hexDisplay">
-            <div style="color: #858585; text-align: center; padding: 20px;">
-                Waiting for SPI data... Connect the target board and start transmission.
-            </div>
-        </div>
-        
-        <!-- <div class="info"> <strong>Instructions:</strong><br> 1. Connect target board (sender) to capture board via SPI (D5→D5, D7→D6, GND→GND)<br> 2. Open target board web interface and start transmission<br> 3. Captured data will appear here in real-time<br> 4. Data is displayed in hexadecimal format with ASCII representation </div> -->
-    </div>
-    
-    <script>
-        let ws = null;
-        let autoScroll = true;
-        let byteBuffer = [];
-        let currentByte = 0;
-        let bitPosition = 0;
-        let address = 0;
-        
-        function connectWebSocket() {
-            const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
-            const wsUrl = protocol + '//' + window.location.hostname + ':81';
-            
-            ws = new WebSocket(wsUrl);
-            
-            ws.onopen = function() {
-                console.log('WebSocket connected');
-                document.getElementById('connectionStatus').textContent = 'Connected';
-                document.getElementById('connectionStatus').className = 'connection-status connected';
-            };
-            
-            ws.onclose = function() {
-                console.log('WebSocket disconnected');
-                document.getElementById('connectionStatus').textContent = 'Disconnected';
-                document.getElementById('connectionStatus').className = 'connection-status disconnected';
-                // Reconnect after 2 seconds
-                setTimeout(connectWebSocket, 2000);
-            };
-            
-            ws.onerror = function(error) {
-                console.error('WebSocket error:', error);
-            };
-            
-            ws.onmessage = function(event) {
-                try {
-                    const data = JSON.parse(event.data);
-                    updateDisplay(data);
-                } catch (e) {
-                    console.error('Error parsing JSON:', e);
-                }
-            };
-        }
-        
-        function updateDisplay(data) {
-            // Update status bar
-            document.getElementById('baudRate').textContent = formatNumber(data.baudRate) + ' Hz';
-            document.getElementById('sampleCount').textContent = formatNumber(data.sampleCount);
-            
-            const bufferUsage = ((data.samplesAvailable / data.bufferSize) * 100).toFixed(1);
-            document.getElementById('bufferUsage').textContent = bufferUsage + '%';
-            document.getElementById('samplesAvailable').textContent = formatNumber(data.samplesAvailable);
-            
-            const overflowEl = document.getElementById('overflow');
-            overflowEl.textContent = data.overflow ? 'Yes' : 'No';
-            overflowEl.className = data.overflow ? 'status-value error' : 'status-value';
-            
-            // Process samples and build bytes
-            if (data.samples && data.samples.length > 0) {
-                const hexDisplay = document.getElementById('hexDisplay');
-                
-                // Clear "waiting" message if present
-                if (hexDisplay.children.length === 1 && hexDisplay.children[0].textContent.includes('Waiting')) {
-                    hexDisplay.innerHTML = '';
-                }
-                
-                data.samples.forEach(sample => {
-                    // Build byte from bits (MSB first, typical for SPI)
-                    currentByte = (currentByte << 1) | sample.data;
-                    bitPosition++;
-                    
-                    if (bitPosition >= 8) {
-                        // Complete byte received
-                        byteBuffer.push(currentByte);
-                        currentByte = 0;
-                        bitPosition = 0;
-                        
-                        // Display when we have 16 bytes (one line)
-                        if (byteBuffer.length >= 16) {
-                            displayHexLine(byteBuffer);
-                            byteBuffer = [];
-                        }
-                    }
-                });
-                
-                // Display remaining bytes if any
-                if (byteBuffer.length > 0 && byteBuffer.length < 16) {
-                    // Wait for more bytes or display partial line
-                }
-                
-                // Auto scroll
-                if (autoScroll) {
-                    hexDisplay.scrollTop = hexDisplay.scrollHeight;
-                }
-            }
-        }
-        
-        function displayHexLine(bytes) {
-            const hexDisplay = document.getElementById('hexDisplay');
-            const line = document.createElement('div');
-            line.className = 'hex-line';
-            
-            // Address
-            const addressSpan = document.createElement('span');
-            addressSpan.className = 'hex-address';
-            addressSpan.textContent = '0x' + padHex(address, 4);
-            line.appendChild(addressSpan);
-            
-            // Hex data
-            const dataSpan = document.createElement('span');
-            dataSpan.className = 'hex-data';
-            dataSpan.textContent = bytes.map(b => padHex(b, 2)).join(' ');
-            line.appendChild(dataSpan);
-            
-            // ASCII representation
-            const asciiSpan = document.createElement('span');
-            asciiSpan.className = 'hex-ascii';
-            asciiSpan.textContent = bytes.map(b => {
-                return (b >= 32 && b <= 126) ? String.fromCharCode(b) : '.';
-            }).join('');
-            line.appendChild(asciiSpan);
-            
-            hexDisplay.appendChild(line);
-            address += bytes.length;
-            
-            // Limit display to last 1000 lines to prevent memory issues
-            while (hexDisplay.children.length > 1000) {
-                hexDisplay.removeChild(hexDisplay.firstChild);
-            }
-        }
-        
-        function padHex(num, width) {
-            return num.toString(16).toUpperCase().padStart(width, '0');
-        }
-        
-        function formatNumber(num) {
-            return num.toString().replace(/\B(?=(\d{3})+(?!\d))/g, ',');
-        }
-        
-        function clearDisplay() {
-            document.getElementById('hexDisplay').innerHTML = '';
-            byteBuffer = [];
-            currentByte = 0;
-            bitPosition = 0;
-            address = 0;
-        }
-        
-        function toggleAutoScroll() {
-            autoScroll = !autoScroll;
-            document.getElementById('autoScrollBtn').textContent = 'Auto Scroll: ' + (autoScroll ? 'ON' : 'OFF');
-        }
-        
-        // Connect on page load
-        connectWebSocket();
-    </script>
-</body>
-</html>
-)HTML";
-
-void handleRoot() { server.send(200, "text/html", htmlPage); }
-
-// IRAM_ATTR ensures interrupt handler runs from IRAM (fast)
-void IRAM_ATTR onClockEdge() {
-  unsigned long currentTime = micros();
-
-  // Read MISO pin state (data bit)
-  uint8_t dataBit = digitalRead(SPI_MISO_PIN);
-
-  // Calculate time since last clock edge (for baud rate calculation)
-  if (lastClockTime > 0) {
-    // timeDelta could be used for baud rate calculation if needed
-    // unsigned long timeDelta = currentTime - lastClockTime;
+typedef CapturePipeline<CaptureConfig> Pipeline;
+CaptureArena arena;
+
+// Position of the stream in the capture ring. Over WebSocket it only moves
+// while a client is connected, so whatever was captured before the first
+// client (up to a full ring) is replayed to it.
+CaptureCursor streamCursor;
+
+// Streaming configuration
+// Samples leave the board as binary frames (see capture_frame.h). By default
+// they go out over the WebSocket; building with -DCAPTURE_SERIAL_TRANSPORT
+// sends the same frames over the USB serial port instead (see
+// serial_link.h), which is more deterministic than WiFi in lab setups.
+#ifdef CAPTURE_SERIAL_TRANSPORT
+#ifndef SERIAL_TRANSPORT_BAUD
+#define SERIAL_TRANSPORT_BAUD 2000000
+#endif
+#define SERIAL_BAUD SERIAL_TRANSPORT_BAUD
+#define FRAME_MAX_SAMPLES 256
+#define STREAM_INTERVAL_MS 10
+#define STREAM_CATCHUP_MS 10
+#else
+#define SERIAL_BAUD 115200
+#define FRAME_MAX_SAMPLES 100
+#define STREAM_INTERVAL_MS 100
+// Frame interval while a backlog is being replayed
+#define STREAM_CATCHUP_MS 20
+#endif
+
+// Frame buffers are fixed-size sub-pools at the front of the capture arena
+#define FRAME_BUFFER_SIZE                                                      \
+  (FRAME_HEADER_SIZE + FRAME_MAX_SAMPLES * FRAME_SAMPLE_SIZE)
+uint8_t *frameBuffer = nullptr;
+uint32_t frameSeq = 0;
+
+// Every decoded byte takes at least two edges, so half a sample frame's
+// worth of records fits, plus one: a UART byte started in the previous
+// frame can end on this frame's first edge, and one whose trailing bits
+// are 1 is finished by flush() with no edge at all
+#define FRAME_MAX_DECODED (FRAME_MAX_SAMPLES / 2 + 1)
+#define DECODED_BUFFER_SIZE                                                    \
+  (FRAME_HEADER_SIZE + FRAME_MAX_DECODED * FRAME_DECODED_SIZE)
+uint8_t *decodedBuffer = nullptr;
+
+// Building with -DCAPTURE_COMPRESSION compresses sample and decoded frames
+// (capture_codec.h) into one more sub-pool before sending, for links where
+// the radio is the limit. A frame that does not shrink goes out raw.
+#ifdef CAPTURE_COMPRESSION
+#define ENCODED_BUFFER_SIZE FRAME_BUFFER_SIZE // the larger of the two
+uint8_t *encodedBuffer = nullptr;
+SampleEncoder sampleEncoder;
+#endif
+
+// Collects decoder output into decodedBuffer. Should the bound above ever
+// be wrong, the excess is counted and the frame flagged rather than lost
+// silently.
+struct DecodedFrameSink {
+  uint16_t count = 0;
+  uint32_t dropped = 0;
+
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    if (count == FRAME_MAX_DECODED) {
+      dropped++;
+      return;
+    }
+    frameWriteDecoded(decodedBuffer + FRAME_HEADER_SIZE +
+                          count * FRAME_DECODED_SIZE,
+                      value, flags, timestamp);
+    count++;
   }
-  lastClockTime = currentTime;
+};
 
-  // Store sample in circular buffer
-  uint16_t nextHead = (bufferHead + 1) % BUFFER_SIZE;
+// Traffic statistics (traffic_stats.h) see every decoded byte, whether or
+// not the stream keeps up: a second decoder drains the ring from its own
+// cursor on every loop(), and a summary frame goes out every
+// STATS_SUMMARY_MS.
+#define STATS_SUMMARY_MS 1000
+CaptureCursor statsCursor;
+Pipeline::Decoder statsDecoder = CaptureConfig::makeDecoder();
+TrafficStats stats(Pipeline::Clock::kEnabled);
+#define SUMMARY_BUFFER_SIZE (FRAME_HEADER_SIZE + STATS_SUMMARY_MAX_SIZE)
+uint8_t *summaryBuffer = nullptr;
+
+// Clients that sent "subscribe summary" get summary frames only; "subscribe
+// all" switches back to the full stream
+bool summaryOnly[WEBSOCKETS_SERVER_CLIENT_MAX];
+
+#ifdef CAPTURE_SERIAL_TRANSPORT
+LinkWriter<HardwareSerial> serialLink(Serial);
+#endif
+
+// Summary frames go to every client, sample and decoded frames only to
+// those subscribed to the full stream
+void sendFrame(const uint8_t *frame, size_t length, bool summary = false) {
+#ifdef CAPTURE_SERIAL_TRANSPORT
+  (void)summary;
+  serialLink.begin();
+  serialLink.write(frame, length);
+  serialLink.end();
+#else
+  if (summary) {
+    webSocket.broadcastBIN(frame, length);
+    return;
+  }
+  for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++) {
+    if (!summaryOnly[num] && webSocket.clientIsConnected(num))
+      webSocket.sendBIN(num, frame, length);
+  }
+#endif
+}
 
-  // Check for buffer overflow
-  if (nextHead == bufferTail) {
-    bufferOverflow = true;
-    // Move tail forward (overwrite oldest data)
-    bufferTail = (bufferTail + 1) % BUFFER_SIZE;
+// Sends a sample or decoded frame. With compression on, its payload has
+// already been encoded into encodedBuffer (encodedPayload bytes, 0 if that
+// did not fit) at a cost of `cycles`, and the smaller version goes out.
+void sendRecords(const FrameHeader &header, const uint8_t *frame,
+                 size_t length, size_t encodedPayload, uint32_t cycles) {
+#ifdef CAPTURE_COMPRESSION
+  size_t encodedLength = FRAME_HEADER_SIZE + encodedPayload;
+  if (encodedPayload > 0 && encodedLength < length) {
+    FrameHeader encoded = header;
+    encoded.flags |= FRAME_FLAG_COMPRESSED;
+    frameWriteHeader(encodedBuffer, encoded);
+    sendFrame(encodedBuffer, encodedLength);
+    stats.onFrameSent(length, encodedLength, true, cycles);
+    return;
   }
+  stats.onFrameSent(length, length, true, cycles);
+#else
+  (void)header;
+  (void)encodedPayload;
+  stats.onFrameSent(length, length, false, cycles);
+#endif
+  sendFrame(frame, length);
+}
 
-  // Store sample
-  buffer[bufferHead].data = dataBit;
-  buffer[bufferHead].timestamp = currentTime;
-  bufferHead = nextHead;
+// Number of clients that want the full stream
+uint8_t streamClients() {
+  uint8_t count = 0;
+  for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++) {
+    if (!summaryOnly[num] && webSocket.clientIsConnected(num))
+      count++;
+  }
+  return count;
+}
 
-  sampleCount++;
-  lastSampleTime = currentTime;
+// Claims the capture arena and lays it out: the send path's fixed buffers
+// first, then the sample ring gets the rest. Safe to call again: capture
+// stops before the old arena is freed, and on failure stays stopped.
+bool configureCapture() {
+  Pipeline::end();
+  if (!arena.begin()) {
+    Serial.printf("Capture arena: only %u bytes of heap free\n",
+                  (unsigned)ESP.getMaxFreeBlockSize());
+    return false;
+  }
+  frameBuffer = (uint8_t *)arena.take(FRAME_BUFFER_SIZE);
+  decodedBuffer = (uint8_t *)arena.take(DECODED_BUFFER_SIZE);
+  summaryBuffer = (uint8_t *)arena.take(SUMMARY_BUFFER_SIZE);
+  bool buffers = frameBuffer && decodedBuffer && summaryBuffer;
+#ifdef CAPTURE_COMPRESSION
+  encodedBuffer = (uint8_t *)arena.take(ENCODED_BUFFER_SIZE);
+  buffers = buffers && encodedBuffer;
+#endif
+  if (!buffers || !Pipeline::begin(arena)) {
+    Serial.printf("Capture arena of %u bytes is too small\n",
+                  (unsigned)arena.size());
+    arena.end();
+    return false;
+  }
+  streamCursor = CaptureCursor();
+  statsCursor = CaptureCursor();
+  statsDecoder.reset();
+
+  Serial.printf("Capture arena: %u bytes, %u sample ring, %u bytes left on "
+                "the heap\n",
+                (unsigned)arena.size(), (unsigned)Pipeline::capacity(),
+                (unsigned)ESP.getFreeHeap());
+  return true;
 }
 
-void setup() {
-  Serial.begin(115200);
-  delay(1000);
+// Feeds decoded bytes to the statistics. Without a clock in the ISR the
+// bytes carry no timestamps, so they are stamped with the time they are
+// decoded, the same time base advance() runs on.
+struct StatsSink {
+  uint32_t now;
 
-  Serial.println("\n=== SPI Capture Board (Receiver) ===");
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    stats.onByte(value, Pipeline::Clock::kEnabled ? timestamp : now, flags);
+  }
+};
 
-  // Configure SPI pins
-  pinMode(SPI_SCK_PIN, INPUT_PULLUP);  // SCK with pull-up
-  pinMode(SPI_MISO_PIN, INPUT_PULLUP); // MISO with pull-up
+// Decodes everything captured since the last call into the statistics
+void updateStats() {
+  // Every edge before this moment is already in the ring
+  uint32_t now = micros();
+  StatsSink sink = {now};
+  uint32_t lost = statsCursor.lost;
+  uint32_t available = Pipeline::available(statsCursor);
+  uint32_t read = Pipeline::read(statsCursor, available,
+                                 [&sink](uint8_t levels, uint32_t timestamp) {
+                                   statsDecoder.feed(levels, timestamp, sink);
+                                 });
+  stats.addLostSamples(statsCursor.lost - lost);
+  if (read == available)
+    statsDecoder.flush(now, sink);
+  stats.advance(now);
+}
 
-  Serial.println("SPI pins configured:");
-  Serial.println("  D5 (GPIO14) = SCK (Clock)");
-  Serial.println("  D6 (GPIO12) = MISO (Data)");
+void sendSummary() {
+  static unsigned long lastSummaryTime = 0;
+  static uint32_t lastSampleCount = 0;
+  unsigned long currentTime = millis();
+  unsigned long elapsedMs = currentTime - lastSummaryTime;
+  if (elapsedMs < STATS_SUMMARY_MS)
+    return;
+  lastSummaryTime = currentTime;
+
+  uint32_t sampleCount = Pipeline::sampleCount();
+  FrameHeader header;
+  header.type = FRAME_SUMMARY;
+  header.flags = 0;
+  header.seq = frameSeq++;
+  header.sampleCount = sampleCount;
+  header.baudRate =
+      (uint32_t)((uint64_t)(sampleCount - lastSampleCount) * 1000 /
+                 elapsedMs);
+  header.bufferSize = Pipeline::capacity();
+  header.samplesAvailable = Pipeline::available(streamCursor);
+  header.count = STATS_SUMMARY_WORDS;
+  lastSampleCount = sampleCount;
+
+  size_t length = frameWriteHeader(summaryBuffer, header);
+  length += stats.writeSummary(summaryBuffer + length, micros());
+  sendFrame(summaryBuffer, length, true);
+}
 
-  // Attach interrupt on SCK pin - trigger on both rising and falling edges
-  // This captures data on both clock edges for maximum sampling rate
-  attachInterrupt(digitalPinToInterrupt(SPI_SCK_PIN), onClockEdge, CHANGE);
+// Frontend page (web/capture_receiver.html, gzipped into flash at build time)
+const WebAsset indexPage = WEB_ASSET(capture_receiver_html, "text/html");
 
-  Serial.println("SPI capture interrupt configured");
-  Serial.println("Capturing on both clock edges (CHANGE mode)");
+void handleRoot() { sendWebAsset(server, indexPage); }
 
-  // Connect to WiFi
-  Serial.print("Connecting to WiFi: ");
-  Serial.println(ssid);
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
+void setup() {
+  Serial.begin(SERIAL_BAUD);
 
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
-  }
+  Serial.println("\n=== SPI Capture Board (Receiver) ===");
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-  } else {
-    Serial.println("\nWiFi connection failed!");
-    Serial.println("Please check your SSID and password in the code.");
-    return;
-  }
+  // Connects in the background from loop(), falling back to an access point
+  wifi.begin(ssid, password, apSsid, apPassword);
 
   // Setup HTTP server (for frontend)
+  collectWebAssetHeaders(server);
   server.on("/", handleRoot);
   server.begin();
 
@@ -448,20 +316,32 @@ void setup() {
         switch (type) {
         case WStype_DISCONNECTED:
           Serial.printf("Client [%u] disconnected\n", num);
+          summaryOnly[num] = false;
           break;
         case WStype_CONNECTED:
           Serial.printf("Client [%u] connected from %s\n", num,
                         webSocket.remoteIP(num).toString().c_str());
+          summaryOnly[num] = false;
           // Send initial status
           {
             String statusMsg = "{\"status\":\"connected\",\"bufferSize\":" +
-                               String(BUFFER_SIZE) + "}";
+                               String(Pipeline::capacity()) +
+                               ",\"protocol\":\"" +
+                               Pipeline::Decoder::name() +
+                               "\",\"backlog\":" +
+                               String(Pipeline::available(streamCursor)) + "}";
             webSocket.sendTXT(num, statusMsg);
           }
           break;
         case WStype_TEXT:
-          // Handle incoming messages if needed
-          Serial.printf("Client [%u] sent: %s\n", num, payload);
+          if (length == 17 && memcmp(payload, "subscribe summary", 17) == 0) {
+            summaryOnly[num] = true;
+          } else if (length == 13 &&
+                     memcmp(payload, "subscribe all", 13) == 0) {
+            summaryOnly[num] = false;
+          } else {
+            Serial.printf("Client [%u] sent: %s\n", num, payload);
+          }
           break;
         default:
           break;
@@ -470,79 +350,147 @@ void setup() {
 
   Serial.println("WebSocket server started on port 81");
   Serial.println("HTTP server started on port 80");
-  Serial.println("Ready to capture SPI data!");
+
+  // Capture starts right away, nothing waits on the network. The servers
+  // have taken their memory by now; the station connection and the
+  // fallback access point come up later and live off CAPTURE_HEAP_RESERVE.
+  if (configureCapture())
+    Serial.printf("Capture on GPIO%d (clock) and GPIO%d (data), decoding "
+                  "%s\n",
+                  CaptureConfig::kClockPin, CaptureConfig::kDataPin,
+                  Pipeline::Decoder::name());
+#ifdef CAPTURE_SERIAL_TRANSPORT
+  Serial.printf("Streaming frames over serial at %d baud\n",
+                SERIAL_TRANSPORT_BAUD);
+#endif
 }
 
 void loop() {
+  wifi.update();
   server.handleClient();
   webSocket.loop();
 
+  // No arena, no capture; the page still loads and shows an empty stream
+  if (Pipeline::capacity() == 0)
+    return;
+
+  // Statistics run over every sample, whatever the link manages
+  updateStats();
+#ifdef CAPTURE_SERIAL_TRANSPORT
+  sendSummary();
+#else
+  if (webSocket.connectedClients() > 0)
+    sendSummary();
+
+  // Nobody wants the full stream: leave the samples in the ring for the
+  // next client that does
+  if (streamClients() == 0)
+    return;
+#endif
+
   // Stream buffer data to all connected WebSocket clients
   static unsigned long lastStreamTime = 0;
+  static bool catchingUp = false;
   unsigned long currentTime = millis();
+  unsigned long elapsedMs = currentTime - lastStreamTime;
 
-  // Stream data every 100ms (10 times per second)
-  if (currentTime - lastStreamTime >= 100) {
+  // Stream data every STREAM_INTERVAL_MS, faster while replaying a backlog
+  if (elapsedMs >= (catchingUp ? STREAM_CATCHUP_MS : STREAM_INTERVAL_MS)) {
     lastStreamTime = currentTime;
 
-    // Calculate buffer status
-    uint16_t samplesAvailable = 0;
-    if (bufferHead >= bufferTail) {
-      samplesAvailable = bufferHead - bufferTail;
-    } else {
-      samplesAvailable = BUFFER_SIZE - bufferTail + bufferHead;
-    }
-
-    // Calculate baud rate from timing (if we have samples)
-    float baudRate = 0;
-    if (sampleCount > 1 && lastClockTime > 0) {
-      // Estimate baud rate from sample count and time
-      unsigned long totalTime =
-          lastSampleTime -
-          (lastSampleTime - (sampleCount * 1000)); // Rough estimate
-      if (totalTime > 0) {
-        baudRate =
-            (float)sampleCount / (totalTime / 1000000.0); // Samples per second
-      }
-    }
-
-    // Create JSON payload with buffer data
-    String json = "{";
-    json += "\"samples\":[";
-
-    // Send up to 100 samples at a time to avoid overwhelming the client
-    uint16_t samplesToSend = min(samplesAvailable, (uint16_t)100);
-    bool first = true;
-
-    for (uint16_t i = 0; i < samplesToSend; i++) {
-      uint16_t idx = (bufferTail + i) % BUFFER_SIZE;
-
-      if (!first)
-        json += ",";
-      first = false;
-
-      json += "{";
-      json += "\"data\":" + String(buffer[idx].data) + ",";
-      json += "\"timestamp\":" + String(buffer[idx].timestamp);
-      json += "}";
-    }
-
-    json += "],";
-    json += "\"bufferHead\":" + String(bufferHead) + ",";
-    json += "\"bufferTail\":" + String(bufferTail) + ",";
-    json += "\"samplesAvailable\":" + String(samplesAvailable) + ",";
-    json += "\"bufferSize\":" + String(BUFFER_SIZE) + ",";
-    json += "\"sampleCount\":" + String(sampleCount) + ",";
-    json += "\"overflow\":" + String(bufferOverflow ? "true" : "false") + ",";
-    json += "\"baudRate\":" + String(baudRate);
-    json += "}";
-
-    // Send to all connected clients
-    webSocket.broadcastTXT(json.c_str(), json.length());
-
-    // Update tail pointer (mark samples as sent)
-    if (samplesToSend > 0) {
-      bufferTail = (bufferTail + samplesToSend) % BUFFER_SIZE;
-    }
+    // Every edge before this moment is already in the buffer
+    uint32_t snapshotTime = micros();
+
+    uint32_t samplesAvailable = Pipeline::available(streamCursor);
+
+    // Edge rate since the last frame, in samples per second
+    static uint32_t lastSampleCount = 0;
+    uint32_t sampleCount = Pipeline::sampleCount();
+    uint32_t baudRate =
+        (uint32_t)((uint64_t)(sampleCount - lastSampleCount) * 1000 /
+                   elapsedMs);
+    lastSampleCount = sampleCount;
+
+    // Send up to FRAME_MAX_SAMPLES samples at a time to avoid overwhelming
+    // the client
+    uint32_t samplesToSend =
+        min(samplesAvailable, (uint32_t)FRAME_MAX_SAMPLES);
+
+    FrameHeader header;
+    header.type = FRAME_SAMPLES;
+    // Flag the frame that follows a gap in the stream
+    static uint32_t reportedLost = 0;
+    header.flags =
+        streamCursor.lost != reportedLost ? FRAME_FLAG_OVERFLOW : 0;
+    reportedLost = streamCursor.lost;
+    header.seq = frameSeq++;
+    header.sampleCount = sampleCount;
+    header.baudRate = baudRate;
+    header.bufferSize = Pipeline::capacity();
+    header.samplesAvailable = samplesAvailable;
+
+    // Samples are decoded (and compressed) as they are sent, so the
+    // decoder sees exactly the sample stream the client does. If the ISR
+    // laps the cursor while we read, fewer samples than planned come out.
+    DecodedFrameSink decoded;
+    size_t frameLength = FRAME_HEADER_SIZE;
+    size_t encodedPayload = 0;
+    uint32_t cycles = 0;
+#ifdef CAPTURE_COMPRESSION
+    sampleEncoder.begin(encodedBuffer + FRAME_HEADER_SIZE,
+                        ENCODED_BUFFER_SIZE - FRAME_HEADER_SIZE);
+#endif
+    uint32_t sent = Pipeline::read(
+        streamCursor, samplesToSend,
+        [&](uint8_t levels, uint32_t timestamp) {
+          frameLength += frameWriteSample(frameBuffer + frameLength, levels,
+                                          timestamp);
+          Pipeline::decoder.feed(levels, timestamp, decoded);
+#ifdef CAPTURE_COMPRESSION
+          uint32_t start = ESP.getCycleCount();
+          sampleEncoder.add(levels, timestamp);
+          cycles += ESP.getCycleCount() - start;
+#endif
+        });
+    header.count = sent;
+    frameWriteHeader(frameBuffer, header);
+#ifdef CAPTURE_COMPRESSION
+    uint32_t start = ESP.getCycleCount();
+    encodedPayload = sampleEncoder.finish();
+    cycles += ESP.getCycleCount() - start;
+#endif
+    sendRecords(header, frameBuffer, frameLength, encodedPayload, cycles);
+
+    // Only once the backlog is drained is the line known to have been
+    // quiet up to snapshotTime
+    catchingUp = sent < samplesAvailable;
+    if (!catchingUp)
+      Pipeline::decoder.flush(snapshotTime, decoded);
+
+    if (decoded.count == 0)
+      return;
+
+    // Numbered only now, so a frame that decoded nothing leaves no gap in
+    // the sequence
+    header.type = FRAME_DECODED;
+    if (decoded.dropped > 0)
+      header.flags |= FRAME_FLAG_OVERFLOW;
+    header.seq = frameSeq++;
+    header.count = decoded.count;
+    frameWriteHeader(decodedBuffer, header);
+    size_t decodedLength =
+        FRAME_HEADER_SIZE + decoded.count * FRAME_DECODED_SIZE;
+
+    cycles = 0;
+#ifdef CAPTURE_COMPRESSION
+    start = ESP.getCycleCount();
+    encodedPayload = codecEncodeDecoded(
+        decodedBuffer + FRAME_HEADER_SIZE, decoded.count,
+        encodedBuffer + FRAME_HEADER_SIZE,
+        ENCODED_BUFFER_SIZE - FRAME_HEADER_SIZE);
+    cycles = ESP.getCycleCount() - start;
+#endif
+    sendRecords(header, decodedBuffer, decodedLength, encodedPayload,
+                cycles);
   }
 }
@@ -4,6 +4,9 @@
 #include <SPI.h>
 #include <pgmspace.h>
 
+#include "generated/target_sender_html.h"
+#include "web_asset.h"
+
 // WiFi credentials - UPDATE THESE
 const char *ssid = "Villa 1";
 const char *password = "66669999";
@@ -35,115 +38,10 @@ String oneOffText = "";
 uint16_t oneOffIndex = 0;
 bool oneOffComplete = false;
 
-// HTML page for rate control
-const char *htmlPage = R"HTML(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>SPI Target Board Control</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { font-family: Arial; margin: 20px; background: #f0f0f0; }
-        .container { background: white; padding: 20px; border-radius: 10px; max-width: 500px; margin: 0 auto; }
-        h1 { color: #333; }
-        .input-group { margin: 15px 0; }
-        label { display: block; margin-bottom: 5px; font-weight: bold; }
-        input[type="number"] { width: 100%; padding: 10px; font-size: 16px; border: 1px solid #ddd; border-radius: 5px; }
-        button { background: #4CAF50; color: white; padding: 12px 24px; border: none; border-radius: 5px; cursor: pointer; font-size: 16px; margin: 5px; }
-        button:hover { background: #45a049; }
-        button.stop { background: #f44336; }
-        button.stop:hover { background: #da190b; }
-        .status { margin-top: 20px; padding: 10px; background: #e7f3ff; border-radius: 5px; }
-        .info { margin: 10px 0; color: #666; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>SPI Target Board Control</h1>
-        
-        <div class="input-group">
-            <label for="mode">Transmission Mode:</label>
-            <select id="mode" style="width: 100%; padding: 10px; font-size: 16px; border: 1px solid #ddd; border-radius: 5px;" onchange="onModeChange()">
-                <option value="continuous">Continuous (Incrementing Data)</option>
-                <option value="oneoff">One-Off (Custom Text)</option>
-            </select>
-        </div>
-        
-        <div class="input-group" id="textInputGroup" style="display:none;">
-            <label for="textInput">Text to Send:</label>
-            <input type="text" id="textInput" placeholder="Enter text to transmit..." style="width: 100%; padding: 10px; font-size: 16px; border: 1px solid #ddd; border-radius: 5px;">
-            <div class="info">Text will be sent byte-by-byte via SPI</div>
-        </div>
-        
-        <div class="input-group">
-            <label for="rate">Transmission Rate (Hz):</label>
-            <input type="number" id="rate" min="1" max="1000000" value="1000" step="1">
-            <div class="info">Range: 1 Hz to 1,000,000 Hz</div>
-        </div>
-        
-        <button onclick="setRate()">Set Rate</button>
-        <button onclick="startTransmit()" id="startBtn">Start Transmission</button>
-        <button onclick="stopTransmit()" class="stop" id="stopBtn" style="display:none;">Stop Transmission</button>
-        
-        <div class="status" id="status">
-            <strong>Status:</strong> <span id="statusText">Ready</span><br>
-            <strong>Current Rate:</strong> <span id="currentRate">1000</span> Hz<br>
-            <strong>Transmitting:</strong> <span id="transmitting">No</span>
-        </div>
-    </div>
-    
-    <script>
-        function onModeChange() {
-            const mode = document.getElementById('mode').value;
-            const textInputGroup = document.getElementById('textInputGroup');
-            if (mode === 'oneoff') {
-                textInputGroup.style.display = 'block';
-            } else {
-                textInputGroup.style.display = 'none';
-            }
-        }
-        
-        function setRate() {
-            const rate = document.getElementById('rate').value;
-            fetch('/setrate?rate=' + rate)
-                .then(r => r.text())
-                .then(data => {
-                    document.getElementById('currentRate').textContent = rate;
-                    document.getElementById('statusText').textContent = 'Rate set to ' + rate + ' Hz';
-                });
-        }
-        
-        function startTransmit() {
-            const mode = document.getElementById('mode').value;
-            const modeParam = mode === 'oneoff' ? '&mode=oneoff' : '&mode=continuous';
-            const textParam = mode === 'oneoff' ? '&text=' + encodeURIComponent(document.getElementById('textInput').value) : '';
-            
-            fetch('/start' + modeParam + textParam)
-                .then(r => r.text())
-                .then(data => {
-                    document.getElementById('transmitting').textContent = 'Yes';
-                    document.getElementById('statusText').textContent = 'Transmitting...';
-                    document.getElementById('startBtn').style.display = 'none';
-                    document.getElementById('stopBtn').style.display = 'inline-block';
-                });
-        }
-        
-        function stopTransmit() {
-            fetch('/stop')
-                .then(r => r.text())
-                .then(data => {
-                    document.getElementById('transmitting').textContent = 'No';
-                    document.getElementById('statusText').textContent = 'Stopped';
-                    document.getElementById('startBtn').style.display = 'inline-block';
-                    document.getElementById('stopBtn').style.display = 'none';
-                });
-        }
-    </script>
-</body>
-</html>
-)HTML";
+// Frontend page (web/target_sender.html, gzipped into flash at build time)
+const WebAsset indexPage = WEB_ASSET(target_sender_html, "text/html");
 
-void handleRoot() { server.send(200, "text/html", htmlPage); }
+void handleRoot() { sendWebAsset(server, indexPage); }
 
 void handleSetRate() {
   if (server.hasArg("rate")) {
@@ -239,6 +137,7 @@ void setup() {
   }
 
   // Setup web server routes
+  collectWebAssetHeaders(server);
   server.on("/", handleRoot);
   server.on("/setrate", handleSetRate);
   server.on("/start", handleStart);
@@ -0,0 +1,406 @@
+// Native unit tests for capture_codec.h: round trips on representative
+// SPI, I2C and UART frames, the fall back to raw frames, and rejection of
+// truncated or corrupt payloads.
+//
+//   pio test -e native -f test_capture_codec
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "capture_codec.h"
+#include "protocol_decoders.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Sample {
+  uint8_t levels;
+  uint32_t timestamp;
+};
+
+// Collects decoder output as FRAME_DECODED records
+struct RecordSink {
+  Bytes records;
+
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    size_t at = records.size();
+    records.resize(at + FRAME_DECODED_SIZE);
+    frameWriteDecoded(&records[at], value, flags, timestamp);
+  }
+};
+
+static FrameHeader makeHeader(uint8_t type, uint16_t count) {
+  FrameHeader h;
+  h.type = type;
+  h.flags = 0;
+  h.seq = 7;
+  h.sampleCount = 12345;
+  h.baudRate = 1000000;
+  h.bufferSize = 4096;
+  h.samplesAvailable = 100;
+  h.count = count;
+  return h;
+}
+
+static Bytes rawSampleFrame(const std::vector<Sample> &samples) {
+  Bytes frame(FRAME_HEADER_SIZE + samples.size() * FRAME_SAMPLE_SIZE);
+  frameWriteHeader(frame.data(), makeHeader(FRAME_SAMPLES, samples.size()));
+  for (size_t i = 0; i < samples.size(); i++)
+    frameWriteSample(&frame[FRAME_HEADER_SIZE + i * FRAME_SAMPLE_SIZE],
+                     samples[i].levels, samples[i].timestamp);
+  return frame;
+}
+
+static Bytes rawDecodedFrame(const Bytes &records) {
+  Bytes frame(FRAME_HEADER_SIZE);
+  frameWriteHeader(frame.data(), makeHeader(FRAME_DECODED,
+                                            records.size() /
+                                                FRAME_DECODED_SIZE));
+  frame.insert(frame.end(), records.begin(), records.end());
+  return frame;
+}
+
+// Compressed copy of a raw frame, empty if the encoder gave up
+static Bytes compress(const Bytes &raw, size_t capacity = FRAME_MAX_SIZE) {
+  FrameHeader header;
+  TEST_ASSERT_TRUE(frameReadHeader(raw.data(), raw.size(), header));
+  Bytes out(FRAME_HEADER_SIZE + capacity);
+  size_t payload = 0;
+  if (header.type == FRAME_SAMPLES) {
+    SampleEncoder encoder;
+    encoder.begin(&out[FRAME_HEADER_SIZE], capacity);
+    for (uint16_t i = 0; i < header.count; i++) {
+      FrameSample s = frameReadSample(raw.data(), i);
+      encoder.add(s.data, s.timestamp);
+    }
+    payload = encoder.finish();
+  } else {
+    payload = codecEncodeDecoded(&raw[FRAME_HEADER_SIZE], header.count,
+                                 &out[FRAME_HEADER_SIZE], capacity);
+  }
+  if (payload == 0)
+    return Bytes();
+  header.flags |= FRAME_FLAG_COMPRESSED;
+  frameWriteHeader(out.data(), header);
+  out.resize(FRAME_HEADER_SIZE + payload);
+  return out;
+}
+
+static void assertRoundTrip(const Bytes &raw, size_t maxCompressed) {
+  Bytes compressed = compress(raw);
+  TEST_ASSERT_TRUE(!compressed.empty());
+  TEST_ASSERT_TRUE(compressed.size() <= maxCompressed);
+  Bytes expanded(FRAME_MAX_SIZE);
+  size_t length = frameExpand(compressed.data(), compressed.size(),
+                              expanded.data(), expanded.size());
+  TEST_ASSERT_EQUAL_size_t(raw.size(), length);
+  TEST_ASSERT_EQUAL_MEMORY(raw.data(), expanded.data(), raw.size());
+}
+
+// SPI mode 0 at 1 us per edge, two samples per bit
+static std::vector<Sample> spiSamples(const Bytes &values, uint32_t start) {
+  std::vector<Sample> samples;
+  uint32_t t = start;
+  for (uint8_t value : values)
+    for (int bit = 7; bit >= 0; bit--) {
+      uint8_t data = (value >> bit) & 1;
+      samples.push_back({data, t++});
+      samples.push_back({(uint8_t)(data | LINE_CLOCK), t++});
+    }
+  return samples;
+}
+
+// I2C as the NoClock build stores it: levels only, timestamps 0
+static std::vector<Sample> i2cSamples(const Bytes &values) {
+  uint8_t levels = LINE_CLOCK | LINE_DATA;
+  std::vector<Sample> samples = {{levels, 0}};
+  auto set = [&](uint8_t next) {
+    if (next != levels)
+      samples.push_back({next, 0});
+    levels = next;
+  };
+  auto bit = [&](uint8_t b) {
+    set(b);
+    set(b | LINE_CLOCK);
+    set(b);
+  };
+  set(LINE_CLOCK);
+  set(0);
+  for (uint8_t value : values) {
+    for (int i = 7; i >= 0; i--)
+      bit((value >> i) & 1);
+    bit(0);
+  }
+  set(0);
+  set(LINE_CLOCK);
+  set(LINE_CLOCK | LINE_DATA);
+  return samples;
+}
+
+// UART 8N1 at 115200 baud on the data line, idle gaps between bursts
+static std::vector<Sample> uartSamples(const Bytes &values) {
+  uint8_t level = LINE_DATA;
+  std::vector<Sample> samples = {{level, 0}};
+  double t = 1000;
+  for (size_t n = 0; n < values.size(); n++) {
+    uint8_t bits[10] = {0};
+    for (int i = 0; i < 8; i++)
+      bits[1 + i] = (values[n] >> i) & 1;
+    bits[9] = 1;
+    for (int i = 0; i < 10; i++, t += 8.68) {
+      uint8_t next = bits[i] ? LINE_DATA : 0;
+      if (next != level)
+        samples.push_back({next, (uint32_t)t});
+      level = next;
+    }
+    if (n % 16 == 15)
+      t += 500;
+  }
+  return samples;
+}
+
+template <class Decoder>
+static Bytes decode(Decoder decoder, const std::vector<Sample> &samples) {
+  RecordSink sink;
+  for (const Sample &s : samples)
+    decoder.feed(s.levels, s.timestamp, sink);
+  decoder.flush(samples.back().timestamp + 1000, sink);
+  return sink.records;
+}
+
+static Bytes text(const char *s) { return Bytes(s, s + strlen(s)); }
+
+void setUp() {}
+void tearDown() {}
+
+static void test_spi_frames() {
+  Bytes values = text("SPI flash read: 03 00 10 00, status ok, status ok");
+  std::vector<Sample> samples = spiSamples(values, 0xFFFFFF00); // wraps
+  samples.resize(250);
+  Bytes raw = rawSampleFrame(samples);
+  assertRoundTrip(raw, raw.size() / 3);
+
+  Bytes records = decode(SpiDecoder<0>(), spiSamples(values, 5000));
+  TEST_ASSERT_EQUAL(values.size(), records.size() / FRAME_DECODED_SIZE);
+  Bytes decoded = rawDecodedFrame(records);
+  assertRoundTrip(decoded, decoded.size() / 2);
+}
+
+static void test_i2c_frames() {
+  Bytes values = {0xA0, 0x00, 0x10, 0xA1, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+  std::vector<Sample> samples = i2cSamples(values);
+  Bytes raw = rawSampleFrame(samples);
+  assertRoundTrip(raw, raw.size() / 3);
+
+  // Few bytes and few repeats: the values go out mostly as literals
+  Bytes records = decode(I2cDecoder(), samples);
+  TEST_ASSERT_EQUAL(values.size(), records.size() / FRAME_DECODED_SIZE);
+  Bytes decoded = rawDecodedFrame(records);
+  assertRoundTrip(decoded, decoded.size() * 2 / 3);
+}
+
+static void test_uart_frames() {
+  Bytes values = text("AT+CWJAP=\"ssid\",\"pass\"\r\nOK\r\nOK\r\nOK\r\n");
+  std::vector<Sample> samples = uartSamples(values);
+  Bytes raw = rawSampleFrame(samples);
+  assertRoundTrip(raw, raw.size());
+
+  Bytes records = decode(UartDecoder<>(115200), samples);
+  TEST_ASSERT_EQUAL(values.size(), records.size() / FRAME_DECODED_SIZE);
+  Bytes decoded = rawDecodedFrame(records);
+  assertRoundTrip(decoded, decoded.size() / 2);
+}
+
+static void test_long_runs_and_edge_cases() {
+  // Steady clock, unchanged data: runs split at CODEC_MAX_RUN
+  std::vector<Sample> samples;
+  for (uint32_t i = 0; i < 1000; i++)
+    samples.push_back({(uint8_t)((i & 1) ? LINE_CLOCK : 0), i * 4});
+  Bytes raw = rawSampleFrame(samples);
+  assertRoundTrip(raw, FRAME_HEADER_SIZE + 64);
+
+  // Timestamps jumping both ways
+  samples.clear();
+  uint32_t t = 0;
+  for (uint32_t i = 0; i < 200; i++) {
+    t += (i % 3 == 0) ? 0x7FFFFFFF : (uint32_t)rand();
+    samples.push_back({(uint8_t)(rand() & 3), t});
+  }
+  Bytes jumpy = rawSampleFrame(samples);
+  Bytes compressed = compress(jumpy);
+  Bytes expanded(FRAME_MAX_SIZE);
+  TEST_ASSERT_TRUE(!compressed.empty());
+  TEST_ASSERT_EQUAL_size_t(jumpy.size(),
+                           frameExpand(compressed.data(), compressed.size(),
+                                       expanded.data(), expanded.size()));
+  TEST_ASSERT_EQUAL_MEMORY(jumpy.data(), expanded.data(), jumpy.size());
+
+  // One record, and long LZ matches at the maximum length and beyond
+  RecordSink sink;
+  sink.onByte(0x42, 99, DECODED_START);
+  assertRoundTrip(rawDecodedFrame(sink.records), 64);
+  sink.records.clear();
+  for (uint32_t i = 0; i < 3000; i++)
+    sink.onByte((uint8_t)(i % 7), 1000 + i * 10, i % 500 == 0);
+  // (one varint per record for timestamp and flags, the values collapse)
+  assertRoundTrip(rawDecodedFrame(sink.records), 3200);
+}
+
+static void test_does_not_fit_sends_raw() {
+  // Random samples: the encoder reports 0 when its output would not fit in
+  // the raw payload's space, so the caller sends the raw frame
+  std::vector<Sample> samples;
+  for (uint32_t i = 0; i < 100; i++)
+    samples.push_back({(uint8_t)(rand() & 3), (uint32_t)rand()});
+  Bytes raw = rawSampleFrame(samples);
+  Bytes tight = compress(raw, 16);
+  TEST_ASSERT_TRUE(tight.empty());
+
+  // Levels beyond LINE_DATA | LINE_CLOCK cannot be run-coded
+  samples[50].levels = 0x04;
+  TEST_ASSERT_TRUE(compress(rawSampleFrame(samples)).empty());
+
+  // Decoded flags must fit in four bits
+  RecordSink sink;
+  sink.onByte(1, 0, 0);
+  sink.onByte(2, 0, 0x10);
+  TEST_ASSERT_TRUE(compress(rawDecodedFrame(sink.records)).empty());
+
+  // Random values don't shrink; a too small buffer gives 0, never overrun
+  sink.records.clear();
+  for (uint32_t i = 0; i < 200; i++)
+    sink.onByte((uint8_t)rand(), (uint32_t)rand(), 0);
+  Bytes decoded = rawDecodedFrame(sink.records);
+  for (size_t capacity = 0; capacity < 300; capacity += 7)
+    TEST_ASSERT_TRUE(compress(decoded, capacity).empty());
+
+  // Empty frames are never encoded
+  TEST_ASSERT_EQUAL_size_t(0, codecEncodeDecoded(nullptr, 0, nullptr, 0));
+}
+
+static void test_rejects_truncated() {
+  Bytes values = text("truncated payload, truncated payload");
+  Bytes samples = compress(rawSampleFrame(spiSamples(values, 0)));
+  Bytes decoded = compress(rawDecodedFrame(decode(
+      SpiDecoder<0>(), spiSamples(values, 0))));
+  Bytes expanded(FRAME_MAX_SIZE);
+  for (const Bytes *frame : {&samples, &decoded}) {
+    TEST_ASSERT_TRUE(!frame->empty());
+    for (size_t len = 0; len < frame->size(); len++) {
+      // Copy so ASan sees reads past the shortened end
+      Bytes cut(frame->begin(), frame->begin() + len);
+      TEST_ASSERT_EQUAL_size_t(0, frameExpand(cut.data(), cut.size(),
+                                              expanded.data(),
+                                              expanded.size()));
+    }
+    // Trailing garbage is rejected too
+    Bytes longer = *frame;
+    longer.push_back(0);
+    TEST_ASSERT_EQUAL_size_t(0, frameExpand(longer.data(), longer.size(),
+                                            expanded.data(),
+                                            expanded.size()));
+    // So is an output buffer too small for the raw frame
+    TEST_ASSERT_EQUAL_size_t(0, frameExpand(frame->data(), frame->size(),
+                                            expanded.data(), 64));
+  }
+}
+
+static Bytes compressedHeader(uint8_t type, uint16_t count) {
+  Bytes frame(FRAME_HEADER_SIZE);
+  FrameHeader h = makeHeader(type, count);
+  h.flags = FRAME_FLAG_COMPRESSED;
+  frameWriteHeader(frame.data(), h);
+  return frame;
+}
+
+static void test_rejects_corrupt() {
+  Bytes expanded(FRAME_MAX_SIZE);
+  auto expand = [&](const Bytes &frame) {
+    return frameExpand(frame.data(), frame.size(), expanded.data(),
+                       expanded.size());
+  };
+
+  // Varint longer than 32 bits
+  Bytes frame = compressedHeader(FRAME_SAMPLES, 1);
+  frame.insert(frame.end(), {0x80, 0x80, 0x80, 0x80, 0x80, 0x01});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+
+  // A run longer than the frame's count
+  frame = compressedHeader(FRAME_SAMPLES, 2);
+  frame.insert(frame.end(), {0x00, (2 << 2) | 1, 0x02});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+
+  // A well-formed two-sample run, for reference
+  frame = compressedHeader(FRAME_SAMPLES, 2);
+  frame.insert(frame.end(), {0x00, (1 << 2) | 1, 0x02});
+  TEST_ASSERT_EQUAL_size_t(FRAME_HEADER_SIZE + 2 * FRAME_SAMPLE_SIZE,
+                           expand(frame));
+
+  // LZ match reaching back before the first value
+  frame = compressedHeader(FRAME_DECODED, 4);
+  frame.insert(frame.end(), {0x00, 0x00, 0x00, 0x00, 0x00});
+  frame.insert(frame.end(), {0x00, 0x41, 0x80, 0x01});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+
+  // Distance 1 back from the second value is fine
+  frame.back() = 0x00;
+  TEST_ASSERT_EQUAL_size_t(FRAME_HEADER_SIZE + 4 * FRAME_DECODED_SIZE,
+                           expand(frame));
+
+  // LZ match running past the count
+  frame = compressedHeader(FRAME_DECODED, 4);
+  frame.insert(frame.end(), {0x00, 0x00, 0x00, 0x00, 0x00});
+  frame.insert(frame.end(), {0x00, 0x41, 0x81, 0x00});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+
+  // Literals running past the count or the payload
+  frame = compressedHeader(FRAME_DECODED, 2);
+  frame.insert(frame.end(), {0x00, 0x00, 0x00, 0x02, 1, 2, 3});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+  frame = compressedHeader(FRAME_DECODED, 2);
+  frame.insert(frame.end(), {0x00, 0x00, 0x00, 0x01, 1});
+  TEST_ASSERT_EQUAL_size_t(0, expand(frame));
+
+  // Random payloads never read or write out of bounds
+  for (int round = 0; round < 20000; round++) {
+    uint8_t type = (round & 1) ? FRAME_SAMPLES : FRAME_DECODED;
+    frame = compressedHeader(type, 1 + rand() % 40);
+    size_t len = rand() % 48;
+    for (size_t i = 0; i < len; i++)
+      frame.push_back((uint8_t)rand());
+    size_t length = expand(frame);
+    FrameHeader header;
+    frameReadHeader(frame.data(), frame.size(), header);
+    TEST_ASSERT_TRUE(length == 0 ||
+                     length == FRAME_HEADER_SIZE +
+                                   header.count * frameRecordSize(type));
+  }
+}
+
+static void test_uncompressed_frames_pass_through() {
+  Bytes raw = rawSampleFrame(spiSamples(text("raw"), 0));
+  Bytes expanded(FRAME_MAX_SIZE);
+  TEST_ASSERT_EQUAL_size_t(raw.size(),
+                           frameExpand(raw.data(), raw.size(),
+                                       expanded.data(), expanded.size()));
+  TEST_ASSERT_EQUAL_MEMORY(raw.data(), expanded.data(), raw.size());
+  // A truncated raw frame fails the header check
+  TEST_ASSERT_EQUAL_size_t(0, frameExpand(raw.data(), raw.size() - 1,
+                                          expanded.data(), expanded.size()));
+}
+
+int main() {
+  srand(1);
+  UNITY_BEGIN();
+  RUN_TEST(test_spi_frames);
+  RUN_TEST(test_i2c_frames);
+  RUN_TEST(test_uart_frames);
+  RUN_TEST(test_long_runs_and_edge_cases);
+  RUN_TEST(test_does_not_fit_sends_raw);
+  RUN_TEST(test_rejects_truncated);
+  RUN_TEST(test_rejects_corrupt);
+  RUN_TEST(test_uncompressed_frames_pass_through);
+  return UNITY_END();
+}
@@ -0,0 +1,330 @@
+// Native unit tests for protocol_decoders.h: synthetic edge sequences in,
+// decoded bytes and flags out.
+//
+//   pio test -e native -f test_protocol_decoders
+
+#include <unity.h>
+
+#include <vector>
+
+#include "protocol_decoders.h"
+
+struct DecodedByte {
+  uint8_t value;
+  uint32_t timestamp;
+  uint8_t flags;
+};
+
+struct RecordingSink {
+  std::vector<DecodedByte> bytes;
+
+  void onByte(uint8_t value, uint32_t timestamp, uint8_t flags) {
+    bytes.push_back({value, timestamp, flags});
+  }
+};
+
+// Feeds one sample per level change, the way the capture ISR produces them
+template <class Decoder> struct EdgeFeeder {
+  Decoder &decoder;
+  RecordingSink &sink;
+  uint8_t levels;
+  uint32_t time = 0;
+
+  void set(uint8_t next, uint32_t dt = 1) {
+    time += dt;
+    if (next == levels)
+      return;
+    levels = next;
+    decoder.feed(levels, time, sink);
+  }
+};
+
+void setUp() {}
+void tearDown() {}
+
+// SPI: eight clock pulses per byte, data set while the clock is idle
+
+template <uint8_t Mode>
+static void spiByte(EdgeFeeder<SpiDecoder<Mode>> &feed, uint8_t value,
+                    uint32_t firstGap = 1) {
+  bool idleHigh = Mode & 2;
+  uint8_t idle = idleHigh ? LINE_CLOCK : 0;
+  uint8_t active = idleHigh ? 0 : LINE_CLOCK;
+  for (int bit = 7; bit >= 0; bit--) {
+    uint8_t data = (value >> bit) & 1;
+    // CPHA 1 shifts data out on the leading edge, samples on the trailing
+    if (Mode & 1) {
+      feed.set(active | data, bit == 7 ? firstGap : 1);
+      feed.set(idle | data);
+    } else {
+      feed.set(idle | data, bit == 7 ? firstGap : 1);
+      feed.set(active | data);
+    }
+  }
+}
+
+static void test_spi_mode0_bytes() {
+  SpiDecoder<0> decoder;
+  RecordingSink sink;
+  EdgeFeeder<SpiDecoder<0>> feed = {decoder, sink, 0};
+  spiByte(feed, 0xA5);
+  spiByte(feed, 0x3C);
+  TEST_ASSERT_EQUAL(2, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0xA5, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x3C, sink.bytes[1].value);
+  TEST_ASSERT_EQUAL_HEX8(0, sink.bytes[1].flags);
+}
+
+static void test_spi_gap_starts_transaction() {
+  SpiDecoder<0> decoder(100);
+  RecordingSink sink;
+  EdgeFeeder<SpiDecoder<0>> feed = {decoder, sink, 0};
+  spiByte(feed, 0x01);
+  spiByte(feed, 0x02, 50);  // within the gap: same transaction
+  spiByte(feed, 0x03, 500); // clock pause: new transaction
+  TEST_ASSERT_EQUAL(3, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(0, sink.bytes[1].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x03, sink.bytes[2].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[2].flags);
+}
+
+static void test_spi_gap_discards_partial_byte() {
+  SpiDecoder<0> decoder(100);
+  RecordingSink sink;
+  EdgeFeeder<SpiDecoder<0>> feed = {decoder, sink, 0};
+  // Three stray clock pulses, then a pause and a whole byte
+  for (int i = 0; i < 3; i++) {
+    feed.set(LINE_DATA);
+    feed.set(LINE_DATA | LINE_CLOCK);
+  }
+  spiByte(feed, 0x5A, 500);
+  TEST_ASSERT_EQUAL(1, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0x5A, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[0].flags);
+}
+
+static void test_spi_other_modes() {
+  {
+    SpiDecoder<1> decoder;
+    RecordingSink sink;
+    EdgeFeeder<SpiDecoder<1>> feed = {decoder, sink, 0};
+    spiByte(feed, 0xC3);
+    TEST_ASSERT_EQUAL(1, sink.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0xC3, sink.bytes[0].value);
+  }
+  {
+    SpiDecoder<2> decoder;
+    RecordingSink sink;
+    EdgeFeeder<SpiDecoder<2>> feed = {decoder, sink, LINE_CLOCK};
+    spiByte(feed, 0x81);
+    TEST_ASSERT_EQUAL(1, sink.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0x81, sink.bytes[0].value);
+  }
+  {
+    SpiDecoder<3> decoder;
+    RecordingSink sink;
+    EdgeFeeder<SpiDecoder<3>> feed = {decoder, sink, LINE_CLOCK};
+    spiByte(feed, 0x7E);
+    TEST_ASSERT_EQUAL(1, sink.bytes.size());
+    TEST_ASSERT_EQUAL_HEX8(0x7E, sink.bytes[0].value);
+  }
+}
+
+// I2C: SCL and SDA both idle high
+
+static void i2cStart(EdgeFeeder<I2cDecoder> &feed) {
+  feed.set(LINE_CLOCK | LINE_DATA);
+  feed.set(LINE_CLOCK); // SDA falls while SCL is high
+  feed.set(0);
+}
+
+static void i2cStop(EdgeFeeder<I2cDecoder> &feed) {
+  feed.set(0);
+  feed.set(LINE_CLOCK);
+  feed.set(LINE_CLOCK | LINE_DATA); // SDA rises while SCL is high
+}
+
+static void i2cBit(EdgeFeeder<I2cDecoder> &feed, uint8_t bit) {
+  feed.set(bit);
+  feed.set(bit | LINE_CLOCK);
+  feed.set(bit);
+}
+
+static void i2cByte(EdgeFeeder<I2cDecoder> &feed, uint8_t value, bool ack) {
+  for (int bit = 7; bit >= 0; bit--)
+    i2cBit(feed, (value >> bit) & 1);
+  i2cBit(feed, ack ? 0 : LINE_DATA);
+}
+
+static void test_i2c_address_data_nak() {
+  I2cDecoder decoder;
+  RecordingSink sink;
+  EdgeFeeder<I2cDecoder> feed = {decoder, sink, LINE_CLOCK | LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  i2cStart(feed);
+  i2cByte(feed, 0xA0, true);
+  i2cByte(feed, 0x12, true);
+  i2cByte(feed, 0x34, false);
+  i2cStop(feed);
+  TEST_ASSERT_EQUAL(3, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0xA0, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START | DECODED_ADDRESS,
+                         sink.bytes[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x12, sink.bytes[1].value);
+  TEST_ASSERT_EQUAL_HEX8(0, sink.bytes[1].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x34, sink.bytes[2].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_NAK, sink.bytes[2].flags);
+}
+
+static void test_i2c_repeated_start() {
+  I2cDecoder decoder;
+  RecordingSink sink;
+  EdgeFeeder<I2cDecoder> feed = {decoder, sink, LINE_CLOCK | LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  i2cStart(feed);
+  i2cByte(feed, 0xA0, true);
+  i2cByte(feed, 0x00, true);
+  // Repeated START: release SDA, raise SCL, then pull SDA low
+  feed.set(LINE_DATA);
+  feed.set(LINE_DATA | LINE_CLOCK);
+  i2cStart(feed);
+  i2cByte(feed, 0xA1, true);
+  i2cByte(feed, 0x55, false);
+  i2cStop(feed);
+  TEST_ASSERT_EQUAL(4, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0xA1, sink.bytes[2].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START | DECODED_ADDRESS,
+                         sink.bytes[2].flags);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_NAK, sink.bytes[3].flags);
+}
+
+static void test_i2c_ignores_bits_outside_frame() {
+  I2cDecoder decoder;
+  RecordingSink sink;
+  EdgeFeeder<I2cDecoder> feed = {decoder, sink, LINE_CLOCK | LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  // Clocking without a START decodes nothing
+  feed.set(LINE_DATA);
+  i2cByte(feed, 0xFF, true);
+  TEST_ASSERT_EQUAL(0, sink.bytes.size());
+}
+
+// UART 8N1 at 100 kbaud: 10 us per bit
+
+#define UART_BIT_US 10
+
+template <bool Inverted>
+static void uartByte(EdgeFeeder<UartDecoder<Inverted>> &feed, uint32_t start,
+                     uint8_t value, bool stopBit = true) {
+  bool bits[10];
+  bits[0] = false;
+  for (int i = 0; i < 8; i++)
+    bits[1 + i] = (value >> i) & 1;
+  bits[9] = stopBit;
+  for (int i = 0; i < 10; i++) {
+    uint8_t level = bits[i] != Inverted ? LINE_DATA : 0;
+    uint32_t at = start + i * UART_BIT_US;
+    if (level != feed.levels)
+      feed.set(level, at - feed.time);
+  }
+}
+
+static void test_uart_bytes_and_start() {
+  UartDecoder<> decoder(100000);
+  RecordingSink sink;
+  EdgeFeeder<UartDecoder<>> feed = {decoder, sink, LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  // 0x55 ends on a rising stop bit edge; 0x0A's last data bit is 0 so
+  // its stop bit is an edge too
+  uartByte(feed, 100, 0x55);
+  uartByte(feed, 200, 0x0A);
+  // 2000 us later: past the 20-bit gap, a new transaction
+  uartByte(feed, 2200, 0x20);
+  decoder.flush(3000, sink);
+  TEST_ASSERT_EQUAL(3, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0x55, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_UINT32(100, sink.bytes[0].timestamp);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x0A, sink.bytes[1].value);
+  TEST_ASSERT_EQUAL_HEX8(0, sink.bytes[1].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x20, sink.bytes[2].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[2].flags);
+}
+
+static void test_uart_trailing_ones_finished_by_flush() {
+  UartDecoder<> decoder(100000);
+  RecordingSink sink;
+  EdgeFeeder<UartDecoder<>> feed = {decoder, sink, LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  // 0xF0: the line rises after bit 3 and stays high through the stop bit
+  uartByte(feed, 100, 0xF0);
+  TEST_ASSERT_EQUAL(0, sink.bytes.size());
+  decoder.flush(150, sink); // mid-byte: nothing yet
+  TEST_ASSERT_EQUAL(0, sink.bytes.size());
+  decoder.flush(200, sink); // past the stop bit centre
+  TEST_ASSERT_EQUAL(1, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0xF0, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START, sink.bytes[0].flags);
+  decoder.flush(300, sink); // only once
+  TEST_ASSERT_EQUAL(1, sink.bytes.size());
+}
+
+static void test_uart_trailing_ones_finished_by_next_start() {
+  UartDecoder<> decoder(100000);
+  RecordingSink sink;
+  EdgeFeeder<UartDecoder<>> feed = {decoder, sink, LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  uartByte(feed, 100, 0xFF); // only the start bit has edges
+  uartByte(feed, 200, 0x01);
+  decoder.flush(400, sink);
+  TEST_ASSERT_EQUAL(2, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(0x01, sink.bytes[1].value);
+}
+
+static void test_uart_framing_error() {
+  UartDecoder<> decoder(100000);
+  RecordingSink sink;
+  EdgeFeeder<UartDecoder<>> feed = {decoder, sink, LINE_DATA};
+  decoder.feed(feed.levels, 0, sink);
+  // Stop bit held low, the line only returns high a bit later
+  uartByte(feed, 100, 0x00, false);
+  feed.set(LINE_DATA, 100 + 11 * UART_BIT_US - feed.time);
+  uartByte(feed, 300, 0x42);
+  decoder.flush(500, sink);
+  TEST_ASSERT_EQUAL(2, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0x00, sink.bytes[0].value);
+  TEST_ASSERT_EQUAL_HEX8(DECODED_START | DECODED_ERROR, sink.bytes[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(0x42, sink.bytes[1].value);
+  TEST_ASSERT_EQUAL_HEX8(0, sink.bytes[1].flags & DECODED_ERROR);
+}
+
+static void test_uart_inverted() {
+  UartDecoder<true> decoder(100000);
+  RecordingSink sink;
+  EdgeFeeder<UartDecoder<true>> feed = {decoder, sink, 0};
+  decoder.feed(feed.levels, 0, sink);
+  uartByte(feed, 100, 0x96);
+  decoder.flush(300, sink);
+  TEST_ASSERT_EQUAL(1, sink.bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(0x96, sink.bytes[0].value);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_spi_mode0_bytes);
+  RUN_TEST(test_spi_gap_starts_transaction);
+  RUN_TEST(test_spi_gap_discards_partial_byte);
+  RUN_TEST(test_spi_other_modes);
+  RUN_TEST(test_i2c_address_data_nak);
+  RUN_TEST(test_i2c_repeated_start);
+  RUN_TEST(test_i2c_ignores_bits_outside_frame);
+  RUN_TEST(test_uart_bytes_and_start);
+  RUN_TEST(test_uart_trailing_ones_finished_by_flush);
+  RUN_TEST(test_uart_trailing_ones_finished_by_next_start);
+  RUN_TEST(test_uart_framing_error);
+  RUN_TEST(test_uart_inverted);
+  return UNITY_END();
+}
@@ -0,0 +1,191 @@
+// Native unit tests for traffic_stats.h: histograms, throughput windows,
+// transaction tracking and the sparse summary payload.
+//
+//   pio test -e native -f test_traffic_stats
+
+#include <unity.h>
+
+#include "traffic_stats.h"
+
+static uint32_t summary[STATS_SUMMARY_WORDS];
+
+// Takes a summary at `now` and reads it back into `summary`
+static size_t takeSummary(const TrafficStats &stats, uint32_t now) {
+  static uint8_t payload[STATS_SUMMARY_MAX_SIZE];
+  size_t length = stats.writeSummary(payload, now);
+  TEST_ASSERT_TRUE(
+      statsReadSummary(payload, length, summary, STATS_SUMMARY_WORDS));
+  return length;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_bucket() {
+  TEST_ASSERT_EQUAL(0, statsBucket(0, STATS_GAP_BUCKETS));
+  TEST_ASSERT_EQUAL(1, statsBucket(1, STATS_GAP_BUCKETS));
+  TEST_ASSERT_EQUAL(2, statsBucket(2, STATS_GAP_BUCKETS));
+  TEST_ASSERT_EQUAL(2, statsBucket(3, STATS_GAP_BUCKETS));
+  TEST_ASSERT_EQUAL(11, statsBucket(1024, STATS_GAP_BUCKETS));
+  TEST_ASSERT_EQUAL(STATS_GAP_BUCKETS - 1,
+                    statsBucket(0xFFFFFFFF, STATS_GAP_BUCKETS));
+}
+
+static void test_histograms_and_transactions() {
+  TrafficStats stats;
+  // Two transactions of three bytes, 10 us apart inside, 1000 us between
+  stats.onByte(0x11, 1000, DECODED_START);
+  stats.onByte(0x22, 1010, 0);
+  stats.onByte(0x22, 1020, DECODED_NAK);
+  stats.onByte(0x33, 2020, DECODED_START);
+  stats.onByte(0x44, 2030, 0);
+  stats.onByte(0x44, 2040, 0);
+  stats.advance(2040 + STATS_TRANSACTION_IDLE_US + 1);
+  takeSummary(stats, 5000);
+
+  TEST_ASSERT_EQUAL_UINT32(5000, summary[STATS_TIMESTAMP]);
+  TEST_ASSERT_EQUAL_UINT32(6, summary[STATS_BYTES]);
+  TEST_ASSERT_EQUAL_UINT32(2, summary[STATS_TRANSACTIONS]);
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_ERRORS]);
+  TEST_ASSERT_EQUAL_UINT32(2, summary[STATS_BYTE_VALUES + 0x22]);
+  TEST_ASSERT_EQUAL_UINT32(2, summary[STATS_BYTE_VALUES + 0x44]);
+  TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_BYTE_VALUES + 0x55]);
+  // 10 us lands in bucket 4 ([8, 16)), 1000 us in bucket 10
+  TEST_ASSERT_EQUAL_UINT32(4, summary[STATS_BYTE_GAPS + 4]);
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_TRANSACTION_GAPS + 10]);
+  // Both transactions are three bytes long: bucket 2
+  TEST_ASSERT_EQUAL_UINT32(2, summary[STATS_LENGTHS + 2]);
+}
+
+static void test_idle_closes_transaction() {
+  TrafficStats stats;
+  stats.onByte(0x01, 0, 0);
+  stats.onByte(0x02, 10, 0);
+  stats.advance(10 + STATS_TRANSACTION_IDLE_US / 2);
+  stats.onByte(0x03, 20 + STATS_TRANSACTION_IDLE_US / 2, 0);
+  stats.advance(1000000);
+  // No START flags: the idle gap alone splits the bytes
+  stats.onByte(0x04, 1000010, 0);
+  stats.advance(2000000);
+  takeSummary(stats, 2000000);
+  TEST_ASSERT_EQUAL_UINT32(2, summary[STATS_TRANSACTIONS]);
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_LENGTHS + 1]); // one byte
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_LENGTHS + 2]); // three bytes
+}
+
+static void test_throughput_windows() {
+  TrafficStats stats;
+  stats.advance(0);
+  // 100 bytes per second for 70 s, then silence
+  for (uint32_t second = 0; second < 70; second++)
+    for (uint32_t i = 0; i < 100; i++)
+      stats.onByte(0, second * 1000000 + i * 1000, 0);
+  stats.advance(70000000);
+  takeSummary(stats, 70000000);
+  TEST_ASSERT_EQUAL_UINT32(100, summary[STATS_THROUGHPUT_1S]);
+  TEST_ASSERT_EQUAL_UINT32(1000, summary[STATS_THROUGHPUT_10S]);
+  TEST_ASSERT_EQUAL_UINT32(6000, summary[STATS_THROUGHPUT_60S]);
+
+  stats.advance(75000000);
+  takeSummary(stats, 75000000);
+  TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_THROUGHPUT_1S]);
+  TEST_ASSERT_EQUAL_UINT32(500, summary[STATS_THROUGHPUT_10S]);
+  TEST_ASSERT_EQUAL_UINT32(5500, summary[STATS_THROUGHPUT_60S]);
+
+  // Longer than the longest window: everything drops to zero
+  stats.advance(200000000);
+  takeSummary(stats, 200000000);
+  TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_THROUGHPUT_10S]);
+  TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_THROUGHPUT_60S]);
+}
+
+// A NoClock build: bytes are stamped with the loop's micros(), here a 10 ms
+// loop running for over an hour, through the wrap of the int32 difference
+// at ~35.8 min. One three-byte I2C transaction per 100 ms, its bytes
+// decoded in consecutive loops.
+static void test_untimed_bytes() {
+  TrafficStats stats(false);
+  uint32_t now = 0;
+  uint32_t transactions = 0;
+  for (uint32_t loop = 0; loop < 400000; loop++) {
+    now += 10000;
+    if (loop % 10 == 0) {
+      stats.onByte(0xA0, now, DECODED_START | DECODED_ADDRESS);
+      transactions++;
+    } else if (loop % 10 < 3) {
+      stats.onByte((uint8_t)loop, now, 0);
+    }
+    stats.advance(now);
+  }
+  takeSummary(stats, now);
+  TEST_ASSERT_EQUAL_UINT32(transactions, summary[STATS_TRANSACTIONS]);
+  TEST_ASSERT_EQUAL_UINT32(transactions - 1, summary[STATS_LENGTHS + 2]);
+  TEST_ASSERT_EQUAL_UINT32(30, summary[STATS_THROUGHPUT_1S]);
+  TEST_ASSERT_EQUAL_UINT32(300, summary[STATS_THROUGHPUT_10S]);
+  // Gaps would only measure the loop
+  for (int i = 0; i < STATS_GAP_BUCKETS; i++) {
+    TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_BYTE_GAPS + i]);
+    TEST_ASSERT_EQUAL_UINT32(0, summary[STATS_TRANSACTION_GAPS + i]);
+  }
+}
+
+static void test_link_words() {
+  TrafficStats stats;
+  stats.onFrameSent(1000, 400, true, 5000);
+  stats.onFrameSent(500, 500, false, 0);
+  takeSummary(stats, 1);
+  TEST_ASSERT_EQUAL_UINT32(1500, summary[STATS_FRAME_BYTES]);
+  TEST_ASSERT_EQUAL_UINT32(900, summary[STATS_WIRE_BYTES]);
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_ENCODED_FRAMES]);
+  TEST_ASSERT_EQUAL_UINT32(5000, summary[STATS_ENCODE_CYCLES]);
+}
+
+static void test_summary_is_sparse() {
+  TrafficStats stats;
+  stats.onByte(0x42, 100, DECODED_START);
+  size_t length = takeSummary(stats, 0xFFFFFFFF);
+  TEST_ASSERT_LESS_THAN(32, length);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, summary[STATS_TIMESTAMP]);
+  TEST_ASSERT_EQUAL_UINT32(1, summary[STATS_BYTE_VALUES + 0x42]);
+
+  // Every word non-zero still fits the worst-case bound
+  for (uint32_t i = 0; i < 256; i++)
+    for (uint32_t j = 0; j <= i; j++)
+      stats.onByte((uint8_t)i, 200 + i * 300000 + j * (1u << (j % 24)),
+                   j == 0 ? DECODED_START : 0);
+  uint8_t payload[STATS_SUMMARY_MAX_SIZE];
+  TEST_ASSERT_TRUE(stats.writeSummary(payload, 1) <= STATS_SUMMARY_MAX_SIZE);
+}
+
+static void test_read_summary_rejects_garbage() {
+  uint32_t words[4];
+  // Skip past the end
+  const uint8_t past[] = {4, 1};
+  TEST_ASSERT_FALSE(statsReadSummary(past, sizeof(past), words, 4));
+  // Truncated varint
+  const uint8_t truncated[] = {0, 0x80};
+  TEST_ASSERT_FALSE(statsReadSummary(truncated, sizeof(truncated), words, 4));
+  // Skip without a word
+  const uint8_t odd[] = {1};
+  TEST_ASSERT_FALSE(statsReadSummary(odd, sizeof(odd), words, 4));
+  // Well-formed: words 1 and 3
+  const uint8_t good[] = {1, 7, 1, 0x80, 0x01};
+  TEST_ASSERT_TRUE(statsReadSummary(good, sizeof(good), words, 4));
+  TEST_ASSERT_EQUAL_UINT32(0, words[0]);
+  TEST_ASSERT_EQUAL_UINT32(7, words[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, words[2]);
+  TEST_ASSERT_EQUAL_UINT32(128, words[3]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket);
+  RUN_TEST(test_histograms_and_transactions);
+  RUN_TEST(test_idle_closes_transaction);
+  RUN_TEST(test_throughput_windows);
+  RUN_TEST(test_untimed_bytes);
+  RUN_TEST(test_link_words);
+  RUN_TEST(test_summary_is_sparse);
+  RUN_TEST(test_read_summary_rejects_garbage);
+  return UNITY_END();
+}